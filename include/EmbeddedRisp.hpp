@@ -1,34 +1,25 @@
-#include "risp.hpp"
+#pragma once
 
-class EmbeddedRisp : public risp::Processor {
+#include "EmbeddedRispBase.hpp"
 
-  protected:
-    class EmbeddedRispNetwork : public risp::Network {
-      public:
-        EmbeddedRispNetwork(neuro::Network *net, double _spike_value_factor,
-                            double _min_potential, char leak,
-                            bool _run_time_inclusive, bool _threshold_inclusive,
-                            bool _fire_like_ravens, bool _discrete,
-                            bool _inputs_from_weights, uint32_t _noisy_seed,
-                            double _noisy_stddev, vector<double> &_weights,
-                            vector<double> &_stds);
+class EmbeddedRisp : public EmbeddedRispBase {
 
-        std::vector<risp::Neuron *> sorted_neuron_vector_public;
-    };
+  protected:
+    std::string gen_packed_synapses_c();
 
   public:
     EmbeddedRisp(neuro::json &params);
     ~EmbeddedRisp();
 
-    bool load_network(neuro::Network *net, int network_id = 0);
-
     std::string gen_static_c(unsigned int max_num_timesteps);
     std::string gen_apply_spike_c();
     std::string gen_run_c();
+    std::string gen_network_quiescent_c();
     std::string gen_clear_activity_c();
     std::string gen_output_last_fire_c();
     std::string gen_output_count_c();
 
-    neuro::Network *rnet;
-    EmbeddedRispNetwork *enet;
+    /* Emit the synapses as packed read-only tables with a weight palette
+     * instead of arrays inside each Neuron */
+    bool compress_synapses;
 };
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "NetworkIR.hpp"
+#include "risp.hpp"
+
+/* Common base of the RISP code generators. Loading a network builds the
+ * NetworkIR that optimization passes rewrite and that every backend generates
+ * C code from. */
+class EmbeddedRispBase : public risp::Processor {
+
+  protected:
+    class EmbeddedRispNetwork : public risp::Network {
+      public:
+        EmbeddedRispNetwork(neuro::Network *net, double _spike_value_factor,
+                            double _min_potential, char leak,
+                            bool _run_time_inclusive, bool _threshold_inclusive,
+                            bool _fire_like_ravens, bool _discrete,
+                            bool _inputs_from_weights, uint32_t _noisy_seed,
+                            double _noisy_stddev, vector<double> &_weights,
+                            vector<double> &_stds);
+
+        std::vector<risp::Neuron *> sorted_neuron_vector_public;
+    };
+
+    std::string gen_defines_c(unsigned int max_num_timesteps);
+    std::string gen_event_capacity_c();
+    std::string gen_io_tables_c();
+    std::string gen_run_time_c();
+    std::string gen_real_types_c();
+    bool real_is_fixed();
+    double real_quantize(double v);
+    std::string real_c(double v);
+    std::string spike_value_factor_c();
+    std::string gen_spike_queue_c();
+    std::string gen_spike_queue_drain_c();
+    std::string gen_output_callback_c();
+    std::string gen_output_callback_call_c(const std::string &last_fire);
+    std::string gen_run_header_c();
+    std::string gen_run_until_defines_c();
+    std::string gen_run_until_check_c(const std::string &last_fire,
+                                      const std::string &fire_count);
+    std::string gen_run_until_wrapper_c();
+    void wcet_reach(std::vector<bool> &live, std::vector<bool> &reached);
+    virtual void wcet_bounds(unsigned int &events, unsigned int &checks,
+                             unsigned int &fires, unsigned int &synapses);
+    std::string gen_wcet_c();
+    std::string gen_tick_c();
+    std::string gen_stats_c();
+
+    /* Fraction bits of the q15 or q31 format, set by compute_real_format() */
+    int real_fraction_bits;
+
+  public:
+    EmbeddedRispBase(neuro::json &params);
+    virtual ~EmbeddedRispBase();
+
+    bool load_network(neuro::Network *net, int network_id = 0);
+
+    virtual std::string gen_static_c(unsigned int max_num_timesteps) = 0;
+
+    neuro::Network *rnet;
+    EmbeddedRispNetwork *enet;
+    NetworkIR *ir;
+
+    /* Capacity of each timestep's charge change event array; 0 sizes it by
+     * NUM_SYNAPSES + NUM_INPUT_NEURONS */
+    unsigned int max_events_per_timestep;
+
+    /* Arithmetic type of charges, weights and thresholds in the generated
+     * code: double, float, q15 or q31 */
+    std::string real_type;
+
+    void compute_real_format();
+    std::string quantization_report();
+
+    /* Capacity of the enqueue_spike() input ring; 0 leaves it out */
+    unsigned int spike_queue_size;
+
+    /* Emit set_output_callback() and call it for every output fire */
+    bool output_callback;
+
+    /* Generate run() as a wrapper of run_until(), which can stop early */
+    bool run_until;
+
+    /* Emit worst-case per-timestep operation counts as WCET_* defines */
+    bool wcet;
+
+    std::string wcet_report();
+
+    /* Emit the double-buffered tick() driver */
+    bool tick;
+};
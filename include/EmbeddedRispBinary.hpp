@@ -0,0 +1,44 @@
+#pragma once
+
+#include "EmbeddedRisp.hpp"
+
+/* Bit-serial code generation for networks whose synapse weights are all -1,
+ * 0 or 1 (e.g. params/risp_1.txt). Fires are kept as one bitset per ring
+ * timestep, and every neuron's incoming synapses are stored as 64-bit masks
+ * of positive, negative and all sources per delay, so the charge a neuron
+ * receives is an AND and a popcount over 64 sources at a time. Other
+ * networks and fire_like_ravens fall back to the sparse backend this class
+ * derives from. */
+class EmbeddedRispBinary : public EmbeddedRisp {
+
+  protected:
+    /* Incoming synapses of one neuron that share a delay and a word of the
+     * fire bitset */
+    struct MaskEntry {
+        unsigned int delay;
+        unsigned int word;
+        unsigned long long pos;
+        unsigned long long neg;
+        unsigned long long any;
+    };
+
+    bool binary_weights();
+    void build_masks();
+    void wcet_bounds(unsigned int &events, unsigned int &checks,
+                     unsigned int &fires, unsigned int &synapses);
+
+    std::vector<MaskEntry> mask_entries;
+    std::vector<unsigned int> neuron_entry_end;
+
+  public:
+    EmbeddedRispBinary(neuro::json &params);
+    ~EmbeddedRispBinary();
+
+    std::string gen_static_c(unsigned int max_num_timesteps);
+    std::string gen_apply_spike_c();
+    std::string gen_run_c();
+    std::string gen_network_quiescent_c();
+    std::string gen_clear_activity_c();
+    std::string gen_output_last_fire_c();
+    std::string gen_output_count_c();
+};
@@ -0,0 +1,26 @@
+#include "EmbeddedRispBase.hpp"
+
+class EmbeddedRispHybrid : public EmbeddedRispBase {
+
+  protected:
+    void partition_neurons();
+    void wcet_bounds(unsigned int &events, unsigned int &checks,
+                     unsigned int &fires, unsigned int &synapses);
+
+    std::vector<bool> neuron_is_hot;
+    std::vector<unsigned int> neuron_ind_to_partition_ind;
+    std::vector<unsigned int> hot_ind_to_neuron_ind;
+    std::vector<unsigned int> cold_ind_to_neuron_ind;
+
+  public:
+    EmbeddedRispHybrid(neuro::json &params);
+    ~EmbeddedRispHybrid();
+
+    std::string gen_static_c(unsigned int max_num_timesteps);
+    std::string gen_apply_spike_c();
+    std::string gen_run_c();
+    std::string gen_network_quiescent_c();
+    std::string gen_clear_activity_c();
+    std::string gen_output_last_fire_c();
+    std::string gen_output_count_c();
+};
@@ -1,35 +1,26 @@
-#include "risp.hpp"
+#include "EmbeddedRispBase.hpp"
 
-class EmbeddedRispSoA : public risp::Processor {
+class EmbeddedRispSoA : public EmbeddedRispBase {
 
   protected:
-    class EmbeddedRispSoANetwork : public risp::Network {
-      public:
-        EmbeddedRispSoANetwork(neuro::Network *net, double _spike_value_factor,
-                               double _min_potential, char leak,
-                               bool _run_time_inclusive,
-                               bool _threshold_inclusive,
-                               bool _fire_like_ravens, bool _discrete,
-                               bool _inputs_from_weights, uint32_t _noisy_seed,
-                               double _noisy_stddev, vector<double> &_weights,
-                               vector<double> &_stds);
-
-        std::vector<risp::Neuron *> sorted_neuron_vector_public;
-    };
+    std::string gen_scatter_tables_c();
+    std::string gen_spmv_tables_c();
+    void wcet_bounds(unsigned int &events, unsigned int &checks,
+                     unsigned int &fires, unsigned int &synapses);
 
   public:
     EmbeddedRispSoA(neuro::json &params);
     ~EmbeddedRispSoA();
 
-    bool load_network(neuro::Network *net, int network_id = 0);
-
     std::string gen_static_c(unsigned int max_num_timesteps);
     std::string gen_apply_spike_c();
     std::string gen_run_c();
+    std::string gen_network_quiescent_c();
     std::string gen_clear_activity_c();
     std::string gen_output_last_fire_c();
     std::string gen_output_count_c();
 
-    neuro::Network *rnet;
-    EmbeddedRispSoANetwork *enet;
+    /* Deliver fires as one sparse matrix-vector product per delay instead of
+     * scattering each fired neuron's synapses */
+    bool spmv_propagation;
 };
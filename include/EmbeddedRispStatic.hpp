@@ -0,0 +1,34 @@
+#pragma once
+
+#include "EmbeddedRisp.hpp"
+
+/* Static schedule code generation for feed-forward networks. Neurons are
+ * simulated layer by layer in a fixed order every timestep, and each neuron's
+ * recent fires are kept in a shift register that its targets test at the
+ * synapse delay. Recurrent networks and fire_like_ravens fall back to the
+ * sparse backend this class derives from. */
+class EmbeddedRispStatic : public EmbeddedRisp {
+
+  protected:
+    bool compute_layers();
+    void wcet_bounds(unsigned int &events, unsigned int &checks,
+                     unsigned int &fires, unsigned int &synapses);
+
+    std::vector<unsigned int> neuron_layer;
+    std::vector<unsigned int> schedule; /* Neuron indices in layer order */
+    std::vector<unsigned int> history_offset;
+    std::vector<unsigned int> history_words;
+    unsigned int num_history_words;
+
+  public:
+    EmbeddedRispStatic(neuro::json &params);
+    ~EmbeddedRispStatic();
+
+    std::string gen_static_c(unsigned int max_num_timesteps);
+    std::string gen_apply_spike_c();
+    std::string gen_run_c();
+    std::string gen_network_quiescent_c();
+    std::string gen_clear_activity_c();
+    std::string gen_output_last_fire_c();
+    std::string gen_output_count_c();
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "risp.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Outgoing synapse of an IRNeuron; to is an index into NetworkIR::neurons */
+struct IRSynapse {
+    unsigned int to;
+    unsigned int delay;
+    double weight;
+};
+
+struct IRNeuron {
+    uint32_t id; /* Node id in the source network */
+    double threshold;
+    bool leak;
+    int input_id;  /* -1 if not an input neuron */
+    int output_id; /* -1 if not an output neuron */
+    std::vector<IRSynapse> synapses;
+};
+
+/* Embedder-internal network representation. It is built once from the
+ * risp::Network that the framework constructs, rewritten in place by the
+ * optimization passes, and then read by every code generator. Neuron indices
+ * in the IR are the neuron indices of the generated C code. */
+class NetworkIR {
+  public:
+    NetworkIR();
+
+    void build(neuro::Network *net,
+               const std::vector<risp::Neuron *> &sorted_neurons);
+
+    unsigned int num_neurons() const;
+    unsigned int num_synapses() const;
+    unsigned int max_outgoing() const;
+    unsigned int max_delay() const;
+    bool has_leak() const;
+    bool all_leak() const;
+    unsigned int max_delay_runs() const;
+
+    std::vector<unsigned int> input_ind_to_neuron_ind() const;
+    std::vector<unsigned int> output_ind_to_neuron_ind() const;
+    std::vector<std::vector<unsigned int>> incoming_neurons() const;
+    std::vector<std::pair<unsigned int, unsigned int>>
+    delay_runs(unsigned int neuron_ind) const;
+
+    void remove_neurons(const std::vector<bool> &remove);
+    void reorder_neurons(const std::vector<unsigned int> &new_to_old);
+    void verify() const;
+
+    std::vector<IRNeuron> neurons;
+    unsigned int num_inputs;
+    unsigned int num_outputs;
+
+    /* Processor parameters that passes and generators depend on */
+    double min_potential;
+    double spike_value_factor;
+    bool threshold_inclusive;
+    bool run_time_inclusive;
+    bool fire_like_ravens;
+    bool discrete;
+    unsigned int proc_max_delay;
+};
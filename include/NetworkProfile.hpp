@@ -0,0 +1,54 @@
+#pragma once
+
+#include "NetworkIR.hpp"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Activity observed while simulating a network IR on a training stimulus.
+ * The stimulus uses the processor_tool command format of
+ * testing/NN/processor_tool.txt; AS, ASR, RUN and CA/CLEAR-A are simulated
+ * and every other command is ignored. */
+class NetworkProfile {
+  public:
+    NetworkProfile();
+
+    void load(const std::string &path);
+    void run(const NetworkIR &ir);
+
+    /* Indexed by IR neuron index, valid after run() */
+    std::vector<unsigned long> fire_counts;
+
+    /* Number of timesteps in which both neurons of a pair (lower index
+     * first) fired */
+    std::map<std::pair<unsigned int, unsigned int>, unsigned long> co_fires;
+
+    /* Largest number of charge change events pending for one timestep */
+    unsigned int peak_events;
+
+  protected:
+    struct Event {
+        unsigned int neuron;
+        double value;
+    };
+
+    void apply_spike(const NetworkIR &ir, uint32_t node_id, long long time,
+                     double value);
+    void process_timestep(const NetworkIR &ir, long long time);
+    void record_fires();
+
+    std::vector<std::vector<std::string>> commands;
+
+    /* IR neuron index of each input neuron's node id, built by run() */
+    std::unordered_map<uint32_t, unsigned int> input_neurons;
+
+    /* Simulation state */
+    std::vector<double> charge;
+    std::vector<bool> check;
+    std::map<long long, std::vector<Event>> events;
+    std::vector<unsigned int> to_fire;
+    std::vector<unsigned int> fired;
+    long long now;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "NetworkIR.hpp"
+#include "NetworkProfile.hpp"
+#include <string>
+#include <vector>
+
+/* A transformation (or check) over the network IR. run() returns whether the
+ * IR was changed. */
+class Pass {
+  public:
+    virtual ~Pass() {}
+
+    virtual std::string name() const = 0;
+    virtual bool run(NetworkIR &ir) = 0;
+};
+
+class PassManager {
+  public:
+    PassManager();
+    ~PassManager();
+
+    void set_profile(NetworkProfile *profile);
+    void add_pass(const std::string &name);
+    void add_passes(const std::string &names);
+    void add_optimization_level(int level);
+    void run(NetworkIR &ir);
+
+    static std::vector<std::string> available_passes();
+
+  protected:
+    Pass *create_pass(const std::string &name);
+
+    std::vector<Pass *> passes;
+    NetworkProfile *profile; /* Stimulus profile, nullptr if not given */
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "NetworkProfile.hpp"
+#include "PassManager.hpp"
+
+/* Checks the IR invariants that code generation relies on; never changes the
+ * IR */
+class VerifyPass : public Pass {
+  public:
+    std::string name() const;
+    bool run(NetworkIR &ir);
+};
+
+/* Removes hidden neurons that can never fire or whose spikes can never reach
+ * an output, along with every synapse that cannot change an output */
+class DeadNeuronEliminationPass : public Pass {
+  public:
+    std::string name() const;
+    bool run(NetworkIR &ir);
+
+  protected:
+    std::vector<bool> find_firing_neurons(const NetworkIR &ir);
+    bool remove_dead_synapses(NetworkIR &ir, const std::vector<bool> &can_fire);
+    bool remove_dead_neurons(NetworkIR &ir);
+};
+
+/* Merges parallel synapses and folds relay neurons into longer-delay
+ * synapses from their predecessor. Each remaining synapse still delivers at
+ * most one event per timestep, so the NUM_SYNAPSES + NUM_INPUT_NEURONS event
+ * capacity of the optimized IR stays large enough. */
+class GraphSimplificationPass : public Pass {
+  public:
+    std::string name() const;
+    bool run(NetworkIR &ir);
+
+  protected:
+    bool merge_parallel_synapses(NetworkIR &ir);
+    bool collapse_relay_neurons(NetworkIR &ir);
+};
+
+/* Renumbers neurons in reverse Cuthill-McKee order, starting from the input
+ * neurons, so that neurons that exchange spikes sit close together in the
+ * generated arrays */
+class NeuronReorderPass : public Pass {
+  public:
+    std::string name() const;
+    bool run(NetworkIR &ir);
+};
+
+/* Simulates the profile stimulus and renumbers neurons so that neurons that
+ * fire together are adjacent, hottest first; neurons that never fired keep
+ * their relative order at the end */
+class ProfileOrderPass : public Pass {
+  public:
+    ProfileOrderPass(NetworkProfile *profile);
+
+    std::string name() const;
+    bool run(NetworkIR &ir);
+
+  protected:
+    NetworkProfile *profile;
+};
+
+/* Stably sorts each neuron's outgoing synapses by delay so that code
+ * generators can emit one run of synapses per delay */
+class DelaySortPass : public Pass {
+  public:
+    std::string name() const;
+    bool run(NetworkIR &ir);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "framework.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Checks generated code against the framework's risp::Processor. The code is
+ * compiled into a shared object, loaded with dlopen() and driven with the
+ * same spikes as the reference one timestep at a time, comparing the output
+ * counts and last fire times after every timestep. The spikes come from a
+ * processor_tool stimulus (AS, ASR, RUN and CA/CLEAR-A are used and every
+ * other command is ignored) or are drawn at random. */
+class Verifier {
+  public:
+    Verifier();
+
+    void load(const std::string &path);
+    void run(neuro::Network *net, nlohmann::json &params,
+             const std::string &code);
+    std::string report() const;
+
+    /* Random stimulus, used when no stimulus file is loaded */
+    unsigned long timesteps;
+    double spike_rate;
+    unsigned long seed;
+
+    /* Compiler for the generated code, $CXX or c++ by default */
+    std::string compiler;
+
+    /* Results, valid after run() */
+    unsigned long checked_timesteps;
+    std::string mismatch;
+    double reference_seconds;
+    double generated_seconds;
+
+  protected:
+    struct Step {
+        bool clear;
+        std::vector<std::pair<unsigned int, double>> spikes;
+    };
+
+    void build_schedule(neuro::Network *net, bool run_time_inclusive);
+
+    std::vector<std::vector<std::string>> commands;
+    bool loaded;
+
+    /* Input spikes to apply before each timestep, by input index */
+    std::vector<Step> schedule;
+};
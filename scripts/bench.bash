@@ -0,0 +1,293 @@
+#!/usr/bin/env bash
+
+# Benchmarks the generated simulators of every network in testing/ and
+# networks/, and of a generated network that is part recurrent, with each
+# backend, framework_embedder options (the default -O1,
+# -O2, and --soa-propagation spmv for rispSoA) and optimization level. The
+# generated code keeps the defines the embedder emitted. Results go to stdout
+# and, one tab-separated line per network, backend, options and level, to
+# bench_output.txt with the commit they were measured on, so that runs on
+# different commits can be compared. rispHybrid is then compared with risp
+# and rispSoA on each network.
+#
+# Environment:
+#   BENCH_REPEAT  times each stimulus is replayed (default 200)
+#   BENCH_OPTS    compiler optimization levels (default "-O2 -O3")
+#   CXX           C++ compiler (default clang++)
+
+supported=$(awk '$1 !~ /^#/ && NF && !seen[$1]++ { print $1 }' scripts/processors.txt)
+processors="${*:-${supported}}"
+for processor in ${processors}; do
+    if ! echo "${supported}" | grep -qx -- "${processor}"; then
+        echo "Procesor ${processor} not supported" >&2
+        echo "    Supported Processors: ("${supported}")" >&2
+        exit 1
+    fi
+done
+
+repeat="${BENCH_REPEAT:-200}"
+opts="${BENCH_OPTS:--O2 -O3}"
+cxx="${CXX:-clang++}"
+results=bench_output.txt
+commit=$(git rev-parse HEAD 2>/dev/null || echo unknown)
+if [ "${commit}" != unknown ] && ! git diff --quiet HEAD -- src include 2>/dev/null; then
+    commit="${commit}-dirty"
+fi
+
+# Checking for full framework
+if [ -z "${fr}" ]; then
+    printf 'Cannot find your fr (framework) environment variable.\n' 2>&1
+    exit 1
+fi
+
+if ! [ -x bin/framework_embedder ]; then
+    echo 'bin/framework_embedder not found, run make all first' >&2
+    exit 1
+fi
+
+# Make benchmark scratch directory
+if ! [ -d bench_scratch ]; then
+    mkdir bench_scratch
+fi
+
+# Replays the stimulus REPEAT times, timing only the run() calls. AS, ASR, RUN
+# and CA/CLEAR-A are replayed and every other command is ignored. Like
+# bin/test_runner, spikes MAX_NUM_TIMESTEPS or more timesteps ahead are held
+# back, and a RUN is split where they become due. With SNN_STATS it instead
+# prints the events applied by one replay.
+bench_harness=$(
+    cat <<'EOF'
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace std;
+
+/* Input spike too far ahead for apply_spike() to accept yet */
+struct Pending_Spike {
+    unsigned long time;
+    int input_ind;
+    double value;
+};
+
+static vector<Pending_Spike> pending;
+static unsigned long now;
+
+static void hold_spike(int input_ind, unsigned int time, double value) {
+    if (time < MAX_NUM_TIMESTEPS) {
+        apply_spike(input_ind, time, value);
+    } else {
+        pending.push_back(Pending_Spike{now + time, input_ind, value});
+    }
+}
+
+static int input_ind_of(int node_id) {
+    for (size_t i = 0; i < NUM_INPUT_NEURONS; i++) {
+        if (INPUT_IND_TO_NODE_ID[i] == (unsigned int)node_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    vector<vector<string>> commands;
+    string line;
+    double seconds = 0;
+    unsigned long timesteps = 0;
+    struct rusage usage;
+
+    while (getline(cin, line)) {
+        stringstream ss(line);
+        string tmp;
+        vector<string> tokens;
+
+        while (ss >> tmp) {
+            tokens.push_back(tmp);
+        }
+        if (!tokens.empty()) {
+            commands.push_back(tokens);
+        }
+    }
+
+    for (int r = 0; r < REPEAT; r++) {
+        clear_activity();
+        pending.clear();
+        now = 0;
+        for (size_t c = 0; c < commands.size(); c++) {
+            vector<string> &tokens = commands[c];
+
+            if (tokens[0] == "ASR") {
+                int input_ind = input_ind_of(stoi(tokens[1]));
+                for (size_t i = 0; i < tokens[2].size(); i++) {
+                    hold_spike(input_ind, i, tokens[2][i] == '1');
+                }
+            } else if (tokens[0] == "AS") {
+                for (size_t i = 1; i + 2 < tokens.size(); i += 3) {
+                    hold_spike(input_ind_of(stoi(tokens[i])),
+                               stoi(tokens[i + 1]), stof(tokens[i + 2]));
+                }
+            } else if (tokens[0] == "RUN") {
+                unsigned long left = stoi(tokens[1]);
+
+                timesteps += left;
+                while (left > 0) {
+                    unsigned long chunk = left;
+
+                    // Apply the held spikes that fit and run up to the next
+                    for (size_t i = 0; i < pending.size();) {
+                        if (pending[i].time - now < MAX_NUM_TIMESTEPS) {
+                            apply_spike(pending[i].input_ind,
+                                        pending[i].time - now,
+                                        pending[i].value);
+                            pending[i] = pending.back();
+                            pending.pop_back();
+                        } else {
+                            chunk = min(chunk, pending[i].time + 1 -
+                                                   MAX_NUM_TIMESTEPS - now);
+                            i++;
+                        }
+                    }
+
+                    auto start = chrono::steady_clock::now();
+                    run(chunk - 1 + STEP);
+                    seconds += chrono::duration<double>(
+                        chrono::steady_clock::now() - start).count();
+                    now += chunk;
+                    left -= chunk;
+                }
+            } else if (tokens[0] == "CLEAR-A" || tokens[0] == "CA") {
+                clear_activity();
+                pending.clear();
+            }
+        }
+    }
+
+#ifdef SNN_STATS
+    SNN_Stats stats;
+    snn_get_stats(&stats);
+    printf("%lu\n", stats.events / REPEAT);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%.1f %ld\n", timesteps ? seconds * 1e9 / timesteps : 0.0,
+           usage.ru_maxrss);
+#endif
+    return 0;
+}
+EOF
+)
+
+printf 'network\tprocessor\tflags\topt\tns_per_timestep\tevents_per_sec\tpeak_rss_kb\ttext\tdata\tbss\tcommit\n' >"${results}"
+
+# framework_embedder options benchmarked with each processor
+configs=$(
+    for processor in ${processors}; do
+        echo "${processor}"
+        echo "${processor} -O2"
+        if [ "${processor}" = rispSoA ]; then
+            echo "${processor} --soa-propagation spmv"
+        fi
+    done
+)
+
+# Feed-forward layers around a few recurrent loops, the networks rispHybrid
+# splits into an event-driven and a dense partition
+bin/network_generator -n 4000 -f 4 -r 0.01 --params params/risp_127.txt --stimulus bench_scratch/mixed.stim >bench_scratch/mixed.json 2>/dev/null
+
+for net_src in testing/* networks/*.json bench_scratch/mixed.json; do
+    scratch=bench_scratch/$(echo "${net_src}" | tr '/' '_')
+
+    if [ -d "${net_src}" ]; then
+        # Build the test network the same way scripts/test.bash does
+        bash "${net_src}"/processor.sh >tmp_proc_params.json
+        (
+            echo M risp tmp_proc_params.json
+            echo EMPTYNET tmp_empty_network.txt
+        ) | "${fr}"/cpp-apps/bin/processor_tool_risp
+        "${fr}"/bin/network_tool <"${net_src}"/network_tool.txt >/dev/null 2>&1
+        cp tmp_network.txt "${scratch}".json
+        cp "${net_src}"/processor_tool.txt "${scratch}".stim
+    elif [ -f "${net_src%.json}".stim ]; then
+        cp "${net_src}" "${scratch}".json
+        cp "${net_src%.json}".stim "${scratch}".stim
+    else
+        # Networks without a stimulus get one spike on every input at time 0
+        cp "${net_src}" "${scratch}".json
+        (
+            for id in $(jq '.Inputs[]' "${net_src}"); do
+                echo "AS ${id} 0 1"
+            done
+            echo RUN 100
+        ) >"${scratch}".stim
+    fi
+
+    # For runtime inclusive we step 0, otherwise 1
+    step=1
+    if [ "$(jq '.Associated_Data.proc_params.run_time_inclusive' "${scratch}".json)" = 'true' ]; then
+        step=0
+    fi
+
+    while read -r processor flags; do
+        if ! bin/framework_embedder -p "${processor}" ${flags} <"${scratch}".json >"${scratch}"_GENERATED.c 2>/dev/null; then
+            echo "Skipping ${net_src} ${processor} ${flags}: code generation failed" >&2
+            continue
+        fi
+
+        (
+            cat "${scratch}"_GENERATED.c
+            echo "#define STEP ${step}"
+            echo "#define REPEAT ${repeat}"
+            echo "${bench_harness}"
+        ) >"${scratch}"_BENCH.cpp
+
+        for opt in ${opts}; do
+            # Footprint of the generated code as it would be deployed
+            "${cxx}" ${opt} -x c++ -c "${scratch}"_GENERATED.c -o "${scratch}".o
+            sizes=$(size "${scratch}".o | awk 'NR == 2 { print $1 "\t" $2 "\t" $3 }')
+
+            "${cxx}" ${opt} -DSNN_STATS "${scratch}"_BENCH.cpp -o "${scratch}"_stats
+            events=$("${scratch}"_stats <"${scratch}".stim)
+
+            "${cxx}" ${opt} "${scratch}"_BENCH.cpp -o "${scratch}"_bench
+            read -r ns rss <<<"$("${scratch}"_bench <"${scratch}".stim)"
+
+            timesteps=$(awk '$1 == "RUN" { t += $2 } END { print t + 0 }' "${scratch}".stim)
+            events_per_sec=$(awk -v e="${events}" -v t="${timesteps}" -v n="${ns}" 'BEGIN { if (t > 0 && n > 0) { printf "%.0f", e / (t * n * 1e-9) } else { print 0 } }')
+
+            printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' "${net_src}" "${processor}" "${flags:--O1}" "${opt}" "${ns}" "${events_per_sec}" "${rss}" "${sizes}" "${commit}" >>"${results}"
+            echo "${net_src} ${processor} ${flags:--O1} ${opt}: ${ns} ns/timestep, ${events_per_sec} events/s, ${rss} KB peak RSS"
+        done
+    done <<<"${configs}"
+done
+
+rm -f tmp_proc_params.json tmp_empty_network.txt tmp_network.txt
+rm -rf bench_scratch
+
+# ns/timestep of rispHybrid relative to risp and rispSoA, below 1 where the
+# hybrid is faster
+awk -F'\t' '
+    NR > 1 { ns[$1 " " $3 " " $4, $2] = $5 }
+    NR > 1 && $2 == "rispHybrid" { keys[++n] = $1 " " $3 " " $4 }
+    END {
+        for (i = 1; i <= n; i++) {
+            k = keys[i]
+            line = ""
+            if ((k, "risp") in ns && ns[k, "risp"] > 0) {
+                line = line sprintf(" %.2fx risp", ns[k, "rispHybrid"] / ns[k, "risp"])
+            }
+            if ((k, "rispSoA") in ns && ns[k, "rispSoA"] > 0) {
+                line = line sprintf(" %.2fx rispSoA", ns[k, "rispHybrid"] / ns[k, "rispSoA"])
+            }
+            if (line != "") {
+                if (!printed++) {
+                    print "\nrispHybrid ns/timestep relative to risp and rispSoA:"
+                }
+                print k ":" line
+            }
+        }
+    }' "${results}"
+
+echo "Results written to ${results}"
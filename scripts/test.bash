@@ -6,9 +6,10 @@ if [ $# -ne 2 ]; then
 fi
 
 processor="${1}"
-if [ "${processor}" != risp ] && [ "${processor}" != rispSoA ]; then
+supported=$(awk '$1 !~ /^#/ && NF && !seen[$1]++ { print $1 }' scripts/processors.txt)
+if ! echo "${supported}" | grep -qx -- "${processor}"; then
     echo "Procesor ${processor} not supported"
-    echo "    Supported Processors: (risp rispSoA)"
+    echo "    Supported Processors: ("${supported}")"
 fi
 
 keep="${2}"
@@ -60,7 +61,7 @@ int main(int argc, char* argv[]) {
             int neuron = stoi(tokens[1]);
             int input_ind;
             for (size_t i = 0; i < NUM_INPUT_NEURONS; i++) {
-                if (INPUT_IND_TO_NEURON_IND[i] == neuron) {
+                if (INPUT_IND_TO_NODE_ID[i] == neuron) {
                     input_ind = i;
                     break;
                 }
@@ -73,7 +74,7 @@ int main(int argc, char* argv[]) {
             for (size_t i = 1; i < tokens.size(); i+=3) {
                 int input_ind;
                 for (size_t j = 0; j < NUM_INPUT_NEURONS; j++) {
-                    if (INPUT_IND_TO_NEURON_IND[j] == stoi(tokens[i])) {
+                    if (INPUT_IND_TO_NODE_ID[j] == stoi(tokens[i])) {
                         input_ind = j;
                         break;
                     }
@@ -93,7 +94,7 @@ int main(int argc, char* argv[]) {
             }
         } else if (tokens[0] == "GSR") {
             for (size_t i = 0; i < NUM_OUTPUT_NEURONS; i++) {
-                printf("%-6u : ", OUTPUT_IND_TO_NEURON_IND[i]);
+                printf("%-6u : ", OUTPUT_IND_TO_NODE_ID[i]);
                 for (size_t j = 0; j < output_raster[i].size(); j++) {
                     printf("%d", output_raster[i][j]);
                 }
@@ -107,11 +108,11 @@ int main(int argc, char* argv[]) {
                     output_spikes += output_raster[i][j];
                 }
 
-                printf("%-6u : %u\n", OUTPUT_IND_TO_NEURON_IND[i], output_spikes);
+                printf("%-6u : %u\n", OUTPUT_IND_TO_NODE_ID[i], output_spikes);
             }
         } else if (tokens[0] == "OT") {
             for (size_t i = 0; i < NUM_OUTPUT_NEURONS; i++) {
-                printf("%-6u : ", OUTPUT_IND_TO_NEURON_IND[i]);
+                printf("%-6u : ", OUTPUT_IND_TO_NODE_ID[i]);
 
                 for (size_t j = 0; j < output_raster[i].size(); j++) {
                     if (output_raster[i][j] == 1) {
@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+# Checks framework_embedder --batch: every network is embedded as it would be
+# on its own, and a network the backend rejects is reported and leaves no
+# file behind without stopping the others.
+#
+# usage: bash scripts/test_batch.bash [processor]
+
+processor="${1:-rispSoA}"
+scratch=testing_scratch/batch
+
+if ! [ -x bin/framework_embedder ] || ! [ -x bin/network_generator ]; then
+    echo 'bin/framework_embedder or bin/network_generator not found, run make all first' >&2
+    exit 1
+fi
+
+rm -rf "${scratch}"
+mkdir -p "${scratch}"/in "${scratch}"/out
+
+# a and c embed, b asks for fire_like_ravens, which rispSoA and rispHybrid
+# reject
+bin/network_generator -n 40 -i 4 -o 4 -f 3 --params params/risp_1.txt -s 1 >"${scratch}"/in/a.json 2>/dev/null
+bin/network_generator -n 40 -i 4 -o 4 -f 3 --params params/risp_1.txt -s 2 2>/dev/null |
+    jq -c '.Associated_Data.proc_params.fire_like_ravens = true' >"${scratch}"/in/b.json
+bin/network_generator -n 40 -i 4 -o 4 -f 3 --params params/risp_1.txt -s 3 >"${scratch}"/in/c.json 2>/dev/null
+
+fail() {
+    echo "Batch test (${processor}) - $1" >&2
+    echo "       Files are in ${scratch}" >&2
+    exit 1
+}
+
+if bin/framework_embedder -p "${processor}" -j 2 --batch "${scratch}"/in --batch-output "${scratch}"/out 2>"${scratch}"/log.txt; then
+    fail "Error: the exit status is 0 although b cannot be embedded"
+fi
+if ! grep -q '^b: .*fire_like_ravens' "${scratch}"/log.txt; then
+    fail "Error: b's failure is not reported in log.txt"
+fi
+if [ -e "${scratch}"/out/b.c ]; then
+    fail "Error: the failed network left out/b.c behind"
+fi
+for name in a c; do
+    bin/framework_embedder -p "${processor}" <"${scratch}"/in/${name}.json >"${scratch}"/${name}.c 2>/dev/null
+    if ! cmp -s "${scratch}"/${name}.c "${scratch}"/out/${name}.c; then
+        fail "Error: out/${name}.c differs from embedding ${name} on its own"
+    fi
+done
+
+echo "Passed Batch test (${processor}) - a failing network does not stop the others"
+rm -rf "${scratch}"
@@ -0,0 +1,219 @@
+#include "Passes.hpp"
+#include <algorithm>
+
+std::string DeadNeuronEliminationPass::name() const { return "dce"; }
+
+bool DeadNeuronEliminationPass::run(NetworkIR &ir) {
+    std::vector<bool> can_fire;
+    bool changed;
+    bool any_change;
+
+    any_change = false;
+    do {
+        can_fire = find_firing_neurons(ir);
+        changed = remove_dead_synapses(ir, can_fire);
+        changed = remove_dead_neurons(ir) || changed;
+        any_change = any_change || changed;
+    } while (changed);
+
+    return any_change;
+}
+
+/* Least fixpoint of "this neuron can ever fire". Input neurons can always
+ * fire. Any other neuron needs an incoming synapse from a neuron that can
+ * fire, and an upper bound on its charge at a threshold check that meets the
+ * threshold. Right before charges are collected a neuron's charge is at most
+ * base = max(0, MIN_POTENTIAL). A leaking neuron then gains at most the sum
+ * of its positive incoming weights, since every synapse delivers at most one
+ * event per timestep. A non-leaking neuron with any positive incoming weight
+ * can accumulate without bound; without one it never exceeds base. */
+std::vector<bool>
+DeadNeuronEliminationPass::find_firing_neurons(const NetworkIR &ir) {
+    std::vector<bool> can_fire;
+    std::vector<bool> has_event;
+    std::vector<bool> unbounded;
+    std::vector<double> max_gain;
+    const IRSynapse *syn;
+    double base;
+    double max_charge;
+    unsigned int i;
+    unsigned int j;
+    bool changed;
+    bool fires;
+
+    base = std::max(0.0, ir.min_potential);
+
+    can_fire.assign(ir.num_neurons(), false);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].input_id >= 0) {
+            can_fire[i] = true;
+        }
+    }
+
+    do {
+        changed = false;
+
+        has_event.assign(ir.num_neurons(), false);
+        unbounded.assign(ir.num_neurons(), false);
+        max_gain.assign(ir.num_neurons(), 0);
+        for (i = 0; i < ir.num_neurons(); i++) {
+            if (!can_fire[i]) {
+                continue;
+            }
+            for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+                syn = &ir.neurons[i].synapses[j];
+                has_event[syn->to] = true;
+                if (syn->weight > 0) {
+                    max_gain[syn->to] += syn->weight;
+                    if (!ir.neurons[syn->to].leak) {
+                        unbounded[syn->to] = true;
+                    }
+                }
+            }
+        }
+
+        for (i = 0; i < ir.num_neurons(); i++) {
+            if (can_fire[i] || !has_event[i]) {
+                continue;
+            }
+
+            max_charge = base + max_gain[i];
+            if (unbounded[i]) {
+                fires = true;
+            } else if (ir.threshold_inclusive) {
+                fires = (max_charge >= ir.neurons[i].threshold);
+            } else {
+                fires = (max_charge > ir.neurons[i].threshold);
+            }
+
+            if (fires) {
+                can_fire[i] = true;
+                changed = true;
+            }
+        }
+    } while (changed);
+
+    return can_fire;
+}
+
+/* Drop synapses out of neurons that never fire, and zero-weight synapses into
+ * neurons that base charge alone can never fire. A zero-weight event only
+ * leaks, clamps to MIN_POTENTIAL and threshold-checks its target, none of
+ * which is observable if the target stays below threshold. */
+bool DeadNeuronEliminationPass::remove_dead_synapses(
+    NetworkIR &ir, const std::vector<bool> &can_fire) {
+    std::vector<IRSynapse> kept;
+    std::vector<bool> base_fires;
+    double base;
+    unsigned int i;
+    unsigned int j;
+    bool changed;
+
+    base = std::max(0.0, ir.min_potential);
+    base_fires.resize(ir.num_neurons());
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.threshold_inclusive) {
+            base_fires[i] = (base >= ir.neurons[i].threshold);
+        } else {
+            base_fires[i] = (base > ir.neurons[i].threshold);
+        }
+    }
+
+    changed = false;
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (!can_fire[i]) {
+            if (!ir.neurons[i].synapses.empty()) {
+                ir.neurons[i].synapses.clear();
+                changed = true;
+            }
+            continue;
+        }
+
+        kept.clear();
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            if (ir.neurons[i].synapses[j].weight == 0 &&
+                !base_fires[ir.neurons[i].synapses[j].to]) {
+                changed = true;
+            } else {
+                kept.push_back(ir.neurons[i].synapses[j]);
+            }
+        }
+        ir.neurons[i].synapses = kept;
+    }
+
+    return changed;
+}
+
+/* A neuron is live if it is reachable from an input and can reach an output.
+ * Hidden neurons that are not live are removed. Input and output neurons are
+ * part of the generated API and are always kept, but an input or output
+ * neuron that cannot reach an output has its synapses dropped. */
+bool DeadNeuronEliminationPass::remove_dead_neurons(NetworkIR &ir) {
+    std::vector<std::vector<unsigned int>> incoming;
+    std::vector<bool> from_input;
+    std::vector<bool> to_output;
+    std::vector<bool> remove;
+    std::vector<unsigned int> stack;
+    std::vector<IRSynapse> kept;
+    unsigned int i;
+    unsigned int j;
+    unsigned int v;
+    bool changed;
+
+    from_input.assign(ir.num_neurons(), false);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].input_id >= 0) {
+            from_input[i] = true;
+            stack.push_back(i);
+        }
+    }
+    while (!stack.empty()) {
+        v = stack.back();
+        stack.pop_back();
+        for (j = 0; j < ir.neurons[v].synapses.size(); j++) {
+            if (!from_input[ir.neurons[v].synapses[j].to]) {
+                from_input[ir.neurons[v].synapses[j].to] = true;
+                stack.push_back(ir.neurons[v].synapses[j].to);
+            }
+        }
+    }
+
+    incoming = ir.incoming_neurons();
+    to_output.assign(ir.num_neurons(), false);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].output_id >= 0) {
+            to_output[i] = true;
+            stack.push_back(i);
+        }
+    }
+    while (!stack.empty()) {
+        v = stack.back();
+        stack.pop_back();
+        for (j = 0; j < incoming[v].size(); j++) {
+            if (!to_output[incoming[v][j]]) {
+                to_output[incoming[v][j]] = true;
+                stack.push_back(incoming[v][j]);
+            }
+        }
+    }
+
+    changed = false;
+    remove.assign(ir.num_neurons(), false);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].input_id < 0 && ir.neurons[i].output_id < 0) {
+            if (!from_input[i] || !to_output[i]) {
+                remove[i] = true;
+                changed = true;
+            }
+        } else if (!to_output[i] && !ir.neurons[i].synapses.empty()) {
+            ir.neurons[i].synapses.clear();
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        ir.remove_neurons(remove);
+    }
+
+    return changed;
+}
@@ -0,0 +1,28 @@
+#include "Passes.hpp"
+#include <algorithm>
+
+static bool delay_less(const IRSynapse &a, const IRSynapse &b) {
+    return a.delay < b.delay;
+}
+
+std::string DelaySortPass::name() const { return "delay-sort"; }
+
+/* Synapses with equal delays keep their relative order, so every timestep
+ * still receives a neuron's events in the same order and the sum of charges
+ * is unchanged even for non-discrete weights */
+bool DelaySortPass::run(NetworkIR &ir) {
+    std::vector<IRSynapse> *synapses;
+    unsigned int i;
+    bool changed;
+
+    changed = false;
+    for (i = 0; i < ir.num_neurons(); i++) {
+        synapses = &ir.neurons[i].synapses;
+        if (!std::is_sorted(synapses->begin(), synapses->end(), delay_less)) {
+            std::stable_sort(synapses->begin(), synapses->end(), delay_less);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
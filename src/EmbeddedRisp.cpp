@@ -1,173 +1,111 @@
 #include "EmbeddedRisp.hpp"
 #include "helpers.hpp"
-#include <unordered_map>
-
-EmbeddedRisp::EmbeddedRispNetwork::EmbeddedRispNetwork(
-    neuro::Network *net, double _spike_value_factor, double _min_potential,
-    char leak, bool _run_time_inclusive, bool _threshold_inclusive,
-    bool _fire_like_ravens, bool _discrete, bool _inputs_from_weights,
-    uint32_t _noisy_seed, double _noisy_stddev, vector<double> &_weights,
-    vector<double> &_stds)
-    : risp::Network(net, _spike_value_factor, _min_potential, leak,
-                    _run_time_inclusive, _threshold_inclusive,
-                    _fire_like_ravens, _discrete, _inputs_from_weights,
-                    _noisy_seed, _noisy_stddev, _weights, _stds) {
-    sorted_neuron_vector_public = sorted_neuron_vector;
-}
-
-EmbeddedRisp::EmbeddedRisp(neuro::json &params) : risp::Processor(params) {
-    rnet = nullptr;
-    enet = nullptr;
-}
+#include <algorithm>
+#include <map>
 
-EmbeddedRisp::~EmbeddedRisp() {
-    if (enet != nullptr) {
-        delete enet;
-    }
+EmbeddedRisp::EmbeddedRisp(neuro::json &params) : EmbeddedRispBase(params) {
+    compress_synapses = false;
 }
 
-bool EmbeddedRisp::load_network(neuro::Network *net, int network_id) {
-    bool res;
-
-    res = risp::Processor::load_network(net, network_id);
-
-    rnet = net;
-    enet = new EmbeddedRispNetwork(
-        net, spike_value_factor, min_potential, leak_mode[0],
-        run_time_inclusive, threshold_inclusive, fire_like_ravens, discrete,
-        inputs_from_weights, noisy_seed, noisy_stddev, weights, stds);
-
-    return res;
-}
+EmbeddedRisp::~EmbeddedRisp() {}
 
 std::string EmbeddedRisp::gen_static_c(unsigned int max_num_timesteps) {
     IndentString s;
-    risp::Neuron *cur_neuron;
-    neuro::Node *cur_node;
-    risp::Synapse *cur_synapse;
-    std::unordered_map<uint32_t, unsigned int> neuron_id_to_ind;
-    std::vector<unsigned int> input_ind_to_neuron_ind;
-    std::vector<unsigned int> output_ind_to_neuron_ind;
+    IRNeuron *cur_neuron;
+    IRSynapse *cur_synapse;
+    std::vector<std::pair<unsigned int, unsigned int>> runs;
     unsigned int i;
     unsigned int j;
-    unsigned int max_outgoing;
-
-    max_outgoing = 0;
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        cur_neuron = enet->sorted_neuron_vector_public[i];
-
-        if (cur_neuron->synapses.size() > max_outgoing) {
-            max_outgoing = cur_neuron->synapses.size();
-        }
-
-        neuron_id_to_ind[cur_neuron->id] = i;
-    }
-
-    rnet->make_sorted_node_vector();
-    input_ind_to_neuron_ind.resize(rnet->num_inputs());
-    output_ind_to_neuron_ind.resize(rnet->num_outputs());
-    for (i = 0; i < rnet->sorted_node_vector.size(); i++) {
-        cur_node = rnet->sorted_node_vector[i];
-        if (cur_node->is_input()) {
-            input_ind_to_neuron_ind[cur_node->input_id] = i;
-        }
-        if (cur_node->is_output()) {
-            output_ind_to_neuron_ind[cur_node->output_id] = i;
-        }
-    }
 
     s = "/******************* RISP NETWORK CODE ***********************/\n"
-        "\n"
-        "#define NUM_NEURONS (" +
-        std::to_string(rnet->num_nodes()) +
-        ")\n"
-        "#define NUM_INPUT_NEURONS (" +
-        std::to_string(rnet->num_inputs()) +
-        ")\n"
-        "#define NUM_OUTPUT_NEURONS (" +
-        std::to_string(rnet->num_outputs()) +
-        ")\n"
-        "#define NUM_SYNAPSES (" +
-        std::to_string(rnet->num_edges()) +
-        ")\n"
-        "#define MAX_NUM_TIMESTEPS (" +
-        std::to_string(max_num_timesteps) +
-        ")\n"
-        "#define MAX_OUTGOING (" +
-        std::to_string(max_outgoing) +
-        ")\n"
-        "#define MIN_POTENTIAL (" +
-        std::to_string(min_potential) +
-        ")\n"
-        "#define SPIKE_VALUE_FACTOR (" +
-        std::to_string(spike_value_factor) +
-        ")\n"
-        "\n"
-        "/* Synapse struct */\n"
-        "typedef struct {\n"
-        "    unsigned int to;    /* Index of to neuron */\n"
-        "    unsigned int delay; /* Synapse delay value */\n"
-        "    double weight;       /* Synapse weight value */\n"
-        "} Synapse;\n"
-        "\n"
-        "/* Neuron struct */\n"
-        "typedef struct {\n"
-        "    unsigned char leak;                         /* Leak value "
-        "(1 for full leak and 0 for no leak) */\n"
-        "    unsigned char check;                        /* Whether or "
-        "not we have checked if this neuron fires */\n"
-        "    unsigned int num_outgoing;                  /* Number of "
-        "outgoing synapses for this neuron */\n"
-        "    unsigned int fire_count;                    /* Number of "
-        "fires */\n"
-        "    int last_fire;                              /* Last firing "
-        "time */\n"
-        "    double charge;                               /* Charge "
-        "value */\n"
-        "    double threshold;                            /* Threshold "
-        "value */\n"
-        "    Synapse outgoing[MAX_OUTGOING];             /* Outgoing "
-        "synapses */\n"
-        "    unsigned int fire_times[MAX_NUM_TIMESTEPS]; /* Firing "
-        "times */\n"
-        "} Neuron;\n"
-        "\n"
-        "/* Charge change event struct (essentially just a pair) */\n"
-        "typedef struct {\n"
-        "    unsigned int neuron_ind; /* Index of neuron to change the "
-        "charge for */\n"
-        "    double charge_change;     /* Value to change charge by */\n"
-        "} Charge_Change_Event;\n"
-        "\n"
-        "const unsigned int INPUT_IND_TO_NEURON_IND[NUM_INPUT_NEURONS] = {";
+        "\n" +
+        gen_defines_c(max_num_timesteps) + gen_event_capacity_c();
 
-    for (i = 0; i < input_ind_to_neuron_ind.size(); i++) {
-        s += std::to_string(input_ind_to_neuron_ind[i]);
-        if (i != input_ind_to_neuron_ind.size() - 1) {
-            s += ", ";
-        }
+    if (compress_synapses) {
+        s += gen_packed_synapses_c();
+    } else {
+        s += "#define MAX_DELAY_RUNS (" +
+             std::to_string(std::max(ir->max_delay_runs(), 1u)) +
+             ")\n"
+             "\n"
+             "/* Synapse struct */\n"
+             "typedef struct {\n"
+             "    unsigned int to;    /* Index of to neuron */\n"
+             "    weight_t weight;     /* Synapse weight value */\n"
+             "} Synapse;\n"
+             "\n"
+             "/* Run of consecutive outgoing synapses that share a delay */\n"
+             "typedef struct {\n"
+             "    unsigned int delay; /* Delay of every synapse in the run */\n"
+             "    unsigned int end;   /* One past the index of the run's last "
+             "synapse */\n"
+             "} Delay_Run;\n";
     }
 
-    s += "};\nconst unsigned int OUTPUT_IND_TO_NEURON_IND[NUM_OUTPUT_NEURONS] "
-         "= {";
+    s += "\n"
+         "#if defined(__GNUC__) || defined(__clang__)\n"
+         "#define CACHE_ALIGNED __attribute__((aligned(64)))\n"
+         "#else\n"
+         "#define CACHE_ALIGNED\n"
+         "#endif\n"
+         "\n"
+         "/* Neuron struct, holding only the state that every event touches so "
+         "that neighboring neurons share cache lines */\n"
+         "typedef struct {\n"
+         "    charge_t charge;     /* Charge value */\n"
+         "    weight_t threshold;  /* Threshold value */\n"
+         "    unsigned char leak;  /* Leak value (1 for full leak and 0 for no "
+         "leak) */\n"
+         "    unsigned char check; /* Whether or not this neuron is on the "
+         "current timestep's touched list */\n"
+         "} Neuron;\n"
+         "\n";
 
-    for (i = 0; i < output_ind_to_neuron_ind.size(); i++) {
-        s += std::to_string(output_ind_to_neuron_ind[i]);
-        if (i != output_ind_to_neuron_ind.size() - 1) {
-            s += ", ";
-        }
+    if (!compress_synapses) {
+        s += "/* Outgoing synapses of a neuron, read only when it fires */\n"
+             "typedef struct {\n"
+             "    unsigned int num_runs;          /* Number of delay runs of "
+             "outgoing synapses for this neuron */\n"
+             "    Synapse outgoing[MAX_OUTGOING]; /* Outgoing synapses, "
+             "grouped by delay */\n"
+             "    Delay_Run runs[MAX_DELAY_RUNS]; /* Delay runs of outgoing "
+             "synapses */\n"
+             "} Neuron_Synapses;\n"
+             "\n";
     }
 
-    s += "};\n"
+    s += "/* Fire record of a neuron for the last run */\n"
+         "typedef struct {\n"
+         "    unsigned int fire_count;                    /* Number of "
+         "fires */\n"
+         "    int last_fire;                              /* Last firing "
+         "time */\n"
+         "    unsigned int fire_times[MAX_NUM_TIMESTEPS]; /* Firing "
+         "times */\n"
+         "} Neuron_History;\n"
          "\n"
+         "/* Charge change event struct (essentially just a pair) */\n"
+         "typedef struct {\n"
+         "    unsigned int neuron_ind; /* Index of neuron to change the "
+         "charge for */\n"
+         "    charge_t charge_change;  /* Value to change charge by */\n"
+         "} Charge_Change_Event;\n"
+         "\n";
+
+    s += gen_io_tables_c();
+
+    s += "\n"
          "unsigned int event_count[MAX_NUM_TIMESTEPS] = {0};                   "
          "/* Number of charge change events for each timestep */\n"
          "unsigned int cur_charge_changes_ind = 0;                             "
          "/* Index of charge changes array that represents which array of "
          "charge change events corresponds to the upcoming timestep */\n"
-         "Charge_Change_Event charge_changes[MAX_NUM_TIMESTEPS][NUM_SYNAPSES]; "
+         "Charge_Change_Event "
+         "charge_changes[MAX_NUM_TIMESTEPS][MAX_EVENTS_PER_TIMESTEP]; "
          "/* Charge changes keyed on timestep and charge change event index "
-         "*/\n";
+         "*/\n"
+         "unsigned int touched[NUM_NEURONS];                                   "
+         "/* Neurons that received an event in the current timestep */\n";
 
     if (fire_like_ravens) {
         s += "unsigned int to_fire[NUM_NEURONS]; /* Neuron indices for "
@@ -177,42 +115,273 @@ std::string EmbeddedRisp::gen_static_c(unsigned int max_num_timesteps) {
              "need to be fired at the beginning of the upcoming timestep */\n";
     }
 
-    s += "Neuron neurons[NUM_NEURONS] = { ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        cur_neuron = enet->sorted_neuron_vector_public[i];
+    s += "Neuron neurons[NUM_NEURONS] CACHE_ALIGNED = { ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        cur_neuron = &ir->neurons[i];
 
-        s += "{" + std::to_string((unsigned char)cur_neuron->leak) + ", 0, " +
-             std::to_string(cur_neuron->synapses.size()) + ", 0, -1, 0, " +
-             std::to_string(cur_neuron->threshold) + ", {";
+        s += "{0, " + real_c(cur_neuron->threshold) + ", " +
+             std::to_string((unsigned char)cur_neuron->leak) + ", 0}";
+        if (i != ir->neurons.size() - 1) {
+            s += ",\n                                             ";
+        }
+    }
+    s += " };\n";
 
-        for (j = 0; j < cur_neuron->synapses.size(); j++) {
-            cur_synapse = cur_neuron->synapses[j];
-            s += "{" + std::to_string(neuron_id_to_ind[cur_synapse->to->id]) +
-                 "," + std::to_string(cur_synapse->delay) + "," +
-                 std::to_string(cur_synapse->weight) + "}";
-            if (j != cur_neuron->synapses.size() - 1) {
-                s += ", ";
+    if (!compress_synapses) {
+        s += "const Neuron_Synapses neuron_synapses[NUM_NEURONS] = { ";
+        for (i = 0; i < ir->neurons.size(); i++) {
+            cur_neuron = &ir->neurons[i];
+
+            runs = ir->delay_runs(i);
+
+            s += "{" + std::to_string(runs.size()) + ", {";
+
+            for (j = 0; j < cur_neuron->synapses.size(); j++) {
+                cur_synapse = &cur_neuron->synapses[j];
+                s += "{" + std::to_string(cur_synapse->to) + "," +
+                     real_c(cur_synapse->weight) + "}";
+                if (j != cur_neuron->synapses.size() - 1) {
+                    s += ", ";
+                }
             }
-        }
 
-        if (cur_neuron->synapses.size() == 0) {
-            s += "{0}";
-        }
+            if (cur_neuron->synapses.size() == 0) {
+                s += "{0}";
+            }
 
-        s += "}, {0}}";
+            s += "}, {";
 
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
-            s += ",\n                                ";
+            for (j = 0; j < runs.size(); j++) {
+                s += "{" + std::to_string(runs[j].first) + "," +
+                     std::to_string(runs[j].second) + "}";
+                if (j != runs.size() - 1) {
+                    s += ", ";
+                }
+            }
+
+            if (runs.size() == 0) {
+                s += "{0}";
+            }
+
+            s += "}}";
+
+            if (i != ir->neurons.size() - 1) {
+                s += ",\n"
+                     "                                                       ";
+            }
+        }
+        s += " };\n";
+    }
+
+    s += "Neuron_History neuron_history[NUM_NEURONS] = { ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        s += "{0, -1, {0}}";
+        if (i != ir->neurons.size() - 1) {
+            s += ", ";
         }
     }
     s += " };\n"
          "\n";
 
     s += gen_apply_spike_c() + "\n";
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_c() + "\n";
+    }
+    if (output_callback) {
+        s += gen_output_callback_c() + "\n";
+    }
+    if (run_until) {
+        s += gen_run_until_defines_c() + "\n" + gen_network_quiescent_c() +
+             "\n";
+    }
     s += gen_run_c() + "\n";
+    if (run_until) {
+        s += gen_run_until_wrapper_c() + "\n";
+    }
     s += gen_clear_activity_c() + "\n";
     s += gen_output_last_fire_c() + "\n";
     s += gen_output_count_c();
+    if (tick) {
+        s += "\n" + gen_tick_c();
+    }
+
+    return s.get_str();
+}
+
+/* Number of bits needed to index num_values values */
+static unsigned int index_bits(unsigned long long num_values) {
+    unsigned int bits;
+
+    bits = 0;
+    while (bits < 64 && (1ULL << bits) < num_values) {
+        bits++;
+    }
+
+    return bits;
+}
+
+/* Smallest <stdint.h> type that holds the given number of bits */
+static std::string packed_type(unsigned int bits) {
+    if (bits <= 8) {
+        return "uint8_t";
+    } else if (bits <= 16) {
+        return "uint16_t";
+    } else if (bits <= 32) {
+        return "uint32_t";
+    }
+    return "uint64_t";
+}
+
+/* Emits the outgoing synapses as read-only packed tables in place of the
+ * per-neuron Synapse and Delay_Run arrays. Each synapse is one word holding
+ * its target neuron index above an index into a palette of the network's
+ * distinct weights, and each delay run is one word holding its delay above
+ * its length. A neuron's runs and synapses are contiguous and start at
+ * neuron_run_start and neuron_synapse_start. */
+std::string EmbeddedRisp::gen_packed_synapses_c() {
+    std::map<double, unsigned int> palette;
+    std::map<double, unsigned int>::iterator pit;
+    std::vector<std::pair<unsigned int, unsigned int>> runs;
+    std::vector<unsigned long long> packed_synapses;
+    std::vector<unsigned long long> packed_runs;
+    std::vector<unsigned int> run_start;
+    std::vector<unsigned int> synapse_start;
+    const IRNeuron *n;
+    IndentString s;
+    unsigned int weight_bits;
+    unsigned int length_bits;
+    unsigned int i;
+    unsigned int j;
+    unsigned int begin;
+
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            palette[ir->neurons[i].synapses[j].weight] = 0;
+        }
+    }
+    if (palette.empty()) {
+        palette[0] = 0;
+    }
+    i = 0;
+    for (pit = palette.begin(); pit != palette.end(); pit++) {
+        pit->second = i++;
+    }
+
+    weight_bits = index_bits(palette.size());
+    length_bits = index_bits(ir->max_outgoing() + 1);
+
+    for (i = 0; i < ir->num_neurons(); i++) {
+        n = &ir->neurons[i];
+        runs = ir->delay_runs(i);
+
+        run_start.push_back(packed_runs.size());
+        synapse_start.push_back(packed_synapses.size());
+
+        begin = 0;
+        for (j = 0; j < runs.size(); j++) {
+            packed_runs.push_back(
+                ((unsigned long long)runs[j].first << length_bits) |
+                (runs[j].second - begin));
+            begin = runs[j].second;
+        }
+        for (j = 0; j < n->synapses.size(); j++) {
+            packed_synapses.push_back(
+                ((unsigned long long)n->synapses[j].to << weight_bits) |
+                palette[n->synapses[j].weight]);
+        }
+    }
+    run_start.push_back(packed_runs.size());
+
+    s = "#include <stdint.h>\n"
+        "\n"
+        "#define NUM_WEIGHTS (" +
+        std::to_string(palette.size()) +
+        ")\n"
+        "#define NUM_PACKED_SYNAPSES (" +
+        std::to_string(std::max((unsigned int)packed_synapses.size(), 1u)) +
+        ")\n"
+        "#define NUM_PACKED_RUNS (" +
+        std::to_string(std::max((unsigned int)packed_runs.size(), 1u)) +
+        ")\n"
+        "#define WEIGHT_INDEX_BITS (" +
+        std::to_string(weight_bits) +
+        ")\n"
+        "#define WEIGHT_INDEX_MASK (" +
+        std::to_string((1ULL << weight_bits) - 1) +
+        ")\n"
+        "#define RUN_LENGTH_BITS (" +
+        std::to_string(length_bits) +
+        ")\n"
+        "#define RUN_LENGTH_MASK (" +
+        std::to_string((1ULL << length_bits) - 1) +
+        ")\n"
+        "\n"
+        "/* Distinct synapse weights */\n"
+        "const weight_t weight_palette[NUM_WEIGHTS] = {\n    ";
+    i = 0;
+    for (pit = palette.begin(); pit != palette.end(); pit++) {
+        s += real_c(pit->first);
+        if (++i != palette.size()) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "/* (target neuron << WEIGHT_INDEX_BITS) | weight palette index, "
+         "grouped by source neuron and delay */\n"
+         "const " +
+         packed_type(index_bits(ir->num_neurons()) + weight_bits) +
+         " packed_synapses[NUM_PACKED_SYNAPSES] = {\n    ";
+    for (i = 0; i < packed_synapses.size(); i++) {
+        s += std::to_string(packed_synapses[i]);
+        if (i != packed_synapses.size() - 1) {
+            s += ", ";
+        }
+    }
+    if (packed_synapses.empty()) {
+        s += "0";
+    }
+    s += "\n};\n"
+         "\n"
+         "/* (delay << RUN_LENGTH_BITS) | number of synapses, for each run of "
+         "equal-delay synapses */\n"
+         "const " +
+         packed_type(index_bits(ir->max_delay() + 1) + length_bits) +
+         " packed_runs[NUM_PACKED_RUNS] = {\n    ";
+    for (i = 0; i < packed_runs.size(); i++) {
+        s += std::to_string(packed_runs[i]);
+        if (i != packed_runs.size() - 1) {
+            s += ", ";
+        }
+    }
+    if (packed_runs.empty()) {
+        s += "0";
+    }
+    s += "\n};\n"
+         "\n"
+         "/* First delay run of each neuron, plus one past the last run */\n"
+         "const " +
+         packed_type(index_bits(packed_runs.size() + 1)) +
+         " neuron_run_start[NUM_NEURONS + 1] = {\n    ";
+    for (i = 0; i < run_start.size(); i++) {
+        s += std::to_string(run_start[i]);
+        if (i != run_start.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "/* First synapse of each neuron */\n"
+         "const " +
+         packed_type(index_bits(packed_synapses.size() + 1)) +
+         " neuron_synapse_start[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < synapse_start.size(); i++) {
+        s += std::to_string(synapse_start[i]);
+        if (i != synapse_start.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
 
     return s.get_str();
 }
@@ -245,14 +414,17 @@ std::string EmbeddedRisp::gen_apply_spike_c() {
          "\n"
          "/* Schedule charge change at current timestep for neuron with given "
          "index */\n"
-         "if(event_count[target_charge_changes_ind] < NUM_SYNAPSES) {\n"
+         "if(event_count[target_charge_changes_ind] < "
+         "MAX_EVENTS_PER_TIMESTEP) {\n"
          "    "
          "charge_changes[target_charge_changes_ind][event_count[target_charge_"
          "changes_ind]].neuron_ind = INPUT_IND_TO_NEURON_IND[input_ind];\n"
          "    "
          "charge_changes[target_charge_changes_ind][event_count[target_charge_"
-         "changes_ind]].charge_change = value * SPIKE_VALUE_FACTOR;\n"
+         "changes_ind]].charge_change = SPIKE_CHARGE(value);\n"
          "    event_count[target_charge_changes_ind]++;\n"
+         "} else {\n"
+         "    SNN_STATS_ADD(dropped_events, 1);\n"
          "}\n";
 
     s.add_indent_spaces(-4);
@@ -264,51 +436,35 @@ std::string EmbeddedRisp::gen_apply_spike_c() {
 
 std::string EmbeddedRisp::gen_run_c() {
     IndentString s;
-    unsigned int i;
     bool net_has_leak;
 
-    net_has_leak = false;
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        if (enet->sorted_neuron_vector_public[i]->leak) {
-            net_has_leak = true;
-        }
-    }
+    net_has_leak = ir->has_leak();
 
-    s = "/* This function will run the SNN for duration, the specified number "
-        "of timesteps (many neuroprocessors only support discrete timesteps, "
-        "such as RISP). */\n"
-        "void run(double duration) {\n";
+    s = gen_run_header_c();
 
     s.add_indent_spaces(4);
 
     s += "unsigned int time;\n"
          "unsigned int i;\n"
          "unsigned int j;\n"
+         "unsigned int r;\n"
          "unsigned int run_time;\n"
          "unsigned int cur_neuron_ind;\n"
          "unsigned int to_time;\n"
+         "unsigned int run_count;\n"
+         "unsigned int run_end;\n"
+         "unsigned int run_stop;\n"
+         "unsigned int touched_count;\n"
+         "Charge_Change_Event *run_events;\n"
          "\n"
          "/* Clear tracking info on all neurons */\n"
          "for (i = 0; i < NUM_NEURONS; i++) {\n"
-         "    neurons[i].last_fire = -1;\n"
-         "    neurons[i].fire_count = 0;\n"
+         "    neuron_history[i].last_fire = -1;\n"
+         "    neuron_history[i].fire_count = 0;\n"
          "}\n"
-         "\n"
-         "/* Ensure run_time is not negative */\n";
+         "\n";
 
-    if (run_time_inclusive) {
-        s += "if (duration < 0) {\n"
-             "    return;\n"
-             "}\n"
-             "\n"
-             "run_time = (unsigned int)duration;\n";
-    } else {
-        s += "if (duration-1 < 0) {\n"
-             "    return;\n"
-             "}\n"
-             "\n"
-             "run_time = (unsigned int)(duration-1);\n";
-    }
+    s += gen_run_time_c();
 
     s += "\n"
          "for (time = 0; time <= run_time; time++) {\n"
@@ -316,34 +472,44 @@ std::string EmbeddedRisp::gen_run_c() {
 
     s.add_indent_spaces(4);
 
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_drain_c() + "\n";
+    }
+
     if (fire_like_ravens) {
         s += "/* Cause any neuron to fire the timestep after its charge "
              "exceeds its threshold (like RAVENS) */\n"
              "for (i = 0; i < to_fire_count; i++) {\n"
              "    cur_neuron_ind = to_fire[i];\n"
-             "    "
-             "neurons[cur_neuron_ind].fire_times[neurons[cur_neuron_ind].fire_"
-             "count] = time;\n"
-             "    neurons[cur_neuron_ind].last_fire = time;\n"
-             "    neurons[cur_neuron_ind].fire_count++;\n"
+             "    neuron_history[cur_neuron_ind].fire_times[neuron_history["
+             "cur_neuron_ind].fire_count] = time;\n"
+             "    neuron_history[cur_neuron_ind].last_fire = time;\n"
+             "    neuron_history[cur_neuron_ind].fire_count++;\n"
              "    neurons[cur_neuron_ind].charge = 0;\n"
              "}\n"
              "to_fire_count = 0;\n"
              "\n";
     }
 
-    if (net_has_leak) {
-        s += "/* Apply leak and reset minimum charge before the next run */\n";
-    } else {
-        s += "/* Reset minimum charge before the next run */\n";
-    }
-
-    s += "for (i = 0; i < event_count[cur_charge_changes_ind]; i++) {\n";
+    s += "/* Collect charges in one pass over the events. The first event of a "
+         "neuron puts it on the touched list and applies its leak and minimum "
+         "charge before any charge is added */\n"
+         "SNN_STATS_ADD(events, event_count[cur_charge_changes_ind]);\n"
+         "SNN_STATS_MAX(peak_events, event_count[cur_charge_changes_ind]);\n"
+         "touched_count = 0;\n"
+         "for (i = 0; i < event_count[cur_charge_changes_ind]; i++) {\n";
 
     s.add_indent_spaces(4);
 
     s += "cur_neuron_ind = "
-         "charge_changes[cur_charge_changes_ind][i].neuron_ind;\n";
+         "charge_changes[cur_charge_changes_ind][i].neuron_ind;\n"
+         "if (neurons[cur_neuron_ind].check == 0) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "neurons[cur_neuron_ind].check = 1;\n"
+         "touched[touched_count] = cur_neuron_ind;\n"
+         "touched_count++;\n";
 
     if (net_has_leak) {
         s += "if (neurons[cur_neuron_ind].leak) {\n"
@@ -358,29 +524,22 @@ std::string EmbeddedRisp::gen_run_c() {
     s.add_indent_spaces(-4);
 
     s += "}\n"
-         "\n";
+         "neurons[cur_neuron_ind].charge += "
+         "charge_changes[cur_charge_changes_ind][i].charge_change;\n";
 
-    s += "/* Collect charges */\n"
-         "for (i = 0; i < event_count[cur_charge_changes_ind]; i++) {\n"
-         "    cur_neuron_ind = "
-         "charge_changes[cur_charge_changes_ind][i].neuron_ind;\n"
-         "    neurons[cur_neuron_ind].check = 1;\n"
-         "    neurons[cur_neuron_ind].charge += "
-         "charge_changes[cur_charge_changes_ind][i].charge_change;\n"
-         "}\n"
-         "\n"
-         "/* Determine if neuron fires */\n"
-         "for (i = 0; i < event_count[cur_charge_changes_ind]; i++) {\n";
-
-    s.add_indent_spaces(4);
+    s.add_indent_spaces(-4);
 
-    s += "cur_neuron_ind = "
-         "charge_changes[cur_charge_changes_ind][i].neuron_ind;\n"
+    s += "}\n"
          "\n"
-         "if (neurons[cur_neuron_ind].check == 1) {\n";
+         "/* Determine if each touched neuron fires */\n"
+         "for (i = 0; i < touched_count; i++) {\n";
 
     s.add_indent_spaces(4);
 
+    s += "cur_neuron_ind = touched[i];\n"
+         "neurons[cur_neuron_ind].check = 0;\n"
+         "\n";
+
     if (threshold_inclusive) {
         s += "/* Fire if neuron charge meets its threshold */\n"
              "if (neurons[cur_neuron_ind].charge >= "
@@ -393,49 +552,94 @@ std::string EmbeddedRisp::gen_run_c() {
 
     s.add_indent_spaces(4);
 
-    s += "for (j = 0; j < neurons[cur_neuron_ind].num_outgoing; j++) {\n"
-         "    to_time = (cur_charge_changes_ind + "
-         "neurons[cur_neuron_ind].outgoing[j].delay) % MAX_NUM_TIMESTEPS;\n"
-         "    if (event_count[to_time] < NUM_SYNAPSES) {\n"
-         "        charge_changes[to_time][event_count[to_time]].neuron_ind = "
-         "neurons[cur_neuron_ind].outgoing[j].to;\n"
-         "        charge_changes[to_time][event_count[to_time]].charge_change "
-         "= neurons[cur_neuron_ind].outgoing[j].weight;\n"
-         "        event_count[to_time]++;\n"
+    s += "/* Append each run of equal-delay synapses to its timestep in one "
+         "go; events that do not fit in the timestep are dropped */\n";
+
+    if (compress_synapses) {
+        s += "j = neuron_synapse_start[cur_neuron_ind];\n"
+             "for (r = neuron_run_start[cur_neuron_ind]; "
+             "r < neuron_run_start[cur_neuron_ind + 1]; r++) {\n"
+             "    to_time = (cur_charge_changes_ind + "
+             "(packed_runs[r] >> RUN_LENGTH_BITS)) % MAX_NUM_TIMESTEPS;\n"
+             "    run_end = j + (packed_runs[r] & RUN_LENGTH_MASK);\n";
+    } else {
+        s += "j = 0;\n"
+             "for (r = 0; r < neuron_synapses[cur_neuron_ind].num_runs; "
+             "r++) {\n"
+             "    to_time = (cur_charge_changes_ind + "
+             "neuron_synapses[cur_neuron_ind].runs[r].delay) % "
+             "MAX_NUM_TIMESTEPS;\n"
+             "    run_end = neuron_synapses[cur_neuron_ind].runs[r].end;\n";
+    }
+
+    s += "    run_events = charge_changes[to_time];\n"
+         "    run_count = event_count[to_time];\n"
+         "    run_stop = run_end;\n"
+         "    if (run_end - j > MAX_EVENTS_PER_TIMESTEP - run_count) {\n"
+         "        run_stop = j + (MAX_EVENTS_PER_TIMESTEP - run_count);\n"
+         "    }\n"
+         "    SNN_STATS_ADD(synapses, run_end - j);\n"
+         "    SNN_STATS_ADD(dropped_events, run_end - run_stop);\n"
+         "    for (; j < run_stop; j++) {\n";
+
+    if (compress_synapses) {
+        s += "        run_events[run_count].neuron_ind = "
+             "packed_synapses[j] >> WEIGHT_INDEX_BITS;\n"
+             "        run_events[run_count].charge_change = "
+             "weight_palette[packed_synapses[j] & WEIGHT_INDEX_MASK];\n";
+    } else {
+        s += "        run_events[run_count].neuron_ind = "
+             "neuron_synapses[cur_neuron_ind].outgoing[j].to;\n"
+             "        run_events[run_count].charge_change = "
+             "neuron_synapses[cur_neuron_ind].outgoing[j].weight;\n";
+    }
+
+    s += "        run_count++;\n"
          "    }\n"
+         "    event_count[to_time] = run_count;\n"
+         "    j = run_end;\n"
          "}\n"
          "\n";
 
+    s += "SNN_STATS_ADD(fires, 1);\n";
     if (fire_like_ravens) {
         s += "to_fire[to_fire_count] = cur_neuron_ind;\n"
              "to_fire_count++;\n";
     } else {
-        s += "neurons[cur_neuron_ind].fire_times[neurons[cur_neuron_ind].fire_"
-             "count] = time;\n"
-             "neurons[cur_neuron_ind].last_fire = time;\n"
-             "neurons[cur_neuron_ind].fire_count++;\n"
+        s += "neuron_history[cur_neuron_ind].fire_times[neuron_history["
+             "cur_neuron_ind].fire_count] = time;\n"
+             "neuron_history[cur_neuron_ind].last_fire = time;\n"
+             "neuron_history[cur_neuron_ind].fire_count++;\n"
              "neurons[cur_neuron_ind].charge = 0;\n";
     }
 
     s.add_indent_spaces(-4);
 
-    s += "}\n"
-         "\n"
-         "neurons[cur_neuron_ind].check = 0;\n";
-
-    s.add_indent_spaces(-4);
-
     s += "}\n";
 
     s.add_indent_spaces(-4);
 
     s += "}\n"
-         "\n"
-         "/* \"Shift\" (using ring buffer) extra spiking events up a timestep "
+         "\n";
+
+    if (output_callback) {
+        s += gen_output_callback_call_c("neuron_history[OUTPUT_IND_TO_NEURON_"
+                                        "IND[i]].last_fire") + "\n";
+    }
+
+    s += "/* \"Shift\" (using ring buffer) extra spiking events up a timestep "
          "to progress to the next timestep */\n"
          "event_count[cur_charge_changes_ind] = 0;\n"
          "cur_charge_changes_ind = (cur_charge_changes_ind + 1) % "
-         "MAX_NUM_TIMESTEPS;\n";
+         "MAX_NUM_TIMESTEPS;\n"
+         "SNN_STATS_ADD(timesteps, 1);\n";
+
+    if (run_until) {
+        s += "\n" +
+             gen_run_until_check_c(
+                 "neuron_history[OUTPUT_IND_TO_NEURON_IND[i]].last_fire",
+                 "neuron_history[OUTPUT_IND_TO_NEURON_IND[i]].fire_count");
+    }
 
     s.add_indent_spaces(-4);
 
@@ -466,6 +670,46 @@ std::string EmbeddedRisp::gen_run_c() {
 
     s += "}\n";
 
+    if (run_until) {
+        s += "\n"
+             "return time;\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* Without pending charge change events (or RAVENS fires) no neuron can fire
+ * again until the next input spike */
+std::string EmbeddedRisp::gen_network_quiescent_c() {
+    IndentString s;
+
+    s = "/* This function will return 1 if no spikes are in flight in the SNN "
+        "and 0 otherwise. */\n"
+        "int network_quiescent(void) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "\n";
+
+    if (fire_like_ravens) {
+        s += "if (to_fire_count != 0) {\n"
+             "    return 0;\n"
+             "}\n";
+    }
+
+    s += "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    if (event_count[i] != 0) {\n"
+         "        return 0;\n"
+         "    }\n"
+         "}\n"
+         "\n"
+         "return 1;\n";
+
     s.add_indent_spaces(-4);
 
     s += "}\n";
@@ -486,8 +730,8 @@ std::string EmbeddedRisp::gen_clear_activity_c() {
          "\n"
          "/* Clear activity-related neuron state */\n"
          "for (i = 0; i < NUM_NEURONS; i++) {\n"
-         "    neurons[i].last_fire = -1;\n"
-         "    neurons[i].fire_count = 0;\n"
+         "    neuron_history[i].last_fire = -1;\n"
+         "    neuron_history[i].fire_count = 0;\n"
          "    neurons[i].charge = 0;\n"
          "}\n"
          "\n"
@@ -526,8 +770,8 @@ std::string EmbeddedRisp::gen_output_last_fire_c() {
          "    return -1;\n"
          "}\n"
          "\n"
-         "return "
-         "(double)neurons[OUTPUT_IND_TO_NEURON_IND[output_ind]].last_fire;\n";
+         "return (double)neuron_history[OUTPUT_IND_TO_NEURON_IND["
+         "output_ind]].last_fire;\n";
 
     s.add_indent_spaces(-4);
 
@@ -553,7 +797,8 @@ std::string EmbeddedRisp::gen_output_count_c() {
          "    return 0;\n"
          "}\n"
          "\n"
-         "return neurons[OUTPUT_IND_TO_NEURON_IND[output_ind]].fire_count;\n";
+         "return neuron_history[OUTPUT_IND_TO_NEURON_IND[output_ind]]."
+         "fire_count;\n";
 
     s.add_indent_spaces(-4);
 
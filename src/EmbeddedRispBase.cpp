@@ -0,0 +1,864 @@
+#include "EmbeddedRispBase.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+EmbeddedRispBase::EmbeddedRispNetwork::EmbeddedRispNetwork(
+    neuro::Network *net, double _spike_value_factor, double _min_potential,
+    char leak, bool _run_time_inclusive, bool _threshold_inclusive,
+    bool _fire_like_ravens, bool _discrete, bool _inputs_from_weights,
+    uint32_t _noisy_seed, double _noisy_stddev, vector<double> &_weights,
+    vector<double> &_stds)
+    : risp::Network(net, _spike_value_factor, _min_potential, leak,
+                    _run_time_inclusive, _threshold_inclusive,
+                    _fire_like_ravens, _discrete, _inputs_from_weights,
+                    _noisy_seed, _noisy_stddev, _weights, _stds) {
+    sorted_neuron_vector_public = sorted_neuron_vector;
+}
+
+EmbeddedRispBase::EmbeddedRispBase(neuro::json &params)
+    : risp::Processor(params) {
+    rnet = nullptr;
+    enet = nullptr;
+    ir = nullptr;
+    max_events_per_timestep = 0;
+    real_type = "double";
+    real_fraction_bits = 0;
+    spike_queue_size = 0;
+    output_callback = false;
+    run_until = false;
+    wcet = false;
+    tick = false;
+}
+
+EmbeddedRispBase::~EmbeddedRispBase() {
+    if (enet != nullptr) {
+        delete enet;
+    }
+    if (ir != nullptr) {
+        delete ir;
+    }
+}
+
+bool EmbeddedRispBase::load_network(neuro::Network *net, int network_id) {
+    bool res;
+
+    res = risp::Processor::load_network(net, network_id);
+
+    rnet = net;
+    enet = new EmbeddedRispNetwork(
+        net, spike_value_factor, min_potential, leak_mode[0],
+        run_time_inclusive, threshold_inclusive, fire_like_ravens, discrete,
+        inputs_from_weights, noisy_seed, noisy_stddev, weights, stds);
+
+    ir = new NetworkIR();
+    ir->build(net, enet->sorted_neuron_vector_public);
+    ir->min_potential = min_potential;
+    ir->spike_value_factor = spike_value_factor;
+    ir->threshold_inclusive = threshold_inclusive;
+    ir->run_time_inclusive = run_time_inclusive;
+    ir->fire_like_ravens = fire_like_ravens;
+    ir->discrete = discrete;
+    ir->proc_max_delay = max_delay;
+
+    return res;
+}
+
+/* NUM_SYNAPSES and MAX_OUTGOING size arrays, and C has no zero-length
+ * arrays, so both are at least 1 even when passes remove every synapse */
+std::string EmbeddedRispBase::gen_defines_c(unsigned int max_num_timesteps) {
+    return "#define NUM_NEURONS (" + std::to_string(ir->num_neurons()) +
+           ")\n"
+           "#define NUM_INPUT_NEURONS (" +
+           std::to_string(ir->num_inputs) +
+           ")\n"
+           "#define NUM_OUTPUT_NEURONS (" +
+           std::to_string(ir->num_outputs) +
+           ")\n"
+           "#define NUM_SYNAPSES (" +
+           std::to_string(std::max(ir->num_synapses(), 1u)) +
+           ")\n"
+           "#define MAX_NUM_TIMESTEPS (" +
+           std::to_string(max_num_timesteps) +
+           ")\n"
+           "#define MAX_OUTGOING (" +
+           std::to_string(std::max(ir->max_outgoing(), 1u)) +
+           ")\n"
+           "#define MIN_POTENTIAL (" +
+           real_c(min_potential) +
+           ")\n"
+           "#define SPIKE_VALUE_FACTOR (" + spike_value_factor_c() + ")\n" +
+           gen_real_types_c() +
+           (wcet ? gen_wcet_c() : "") + gen_stats_c();
+}
+
+/* True if real_type is one of the fixed-point formats */
+bool EmbeddedRispBase::real_is_fixed() {
+    return real_type == "q15" || real_type == "q31";
+}
+
+/* Sets the fraction bits of the fixed-point format. The binary point is
+ * placed as far left as the largest magnitude among the weights, thresholds
+ * and minimum potential allows, so that all of them fit in a signed 16 (q15)
+ * or 32 (q31) bit word. Passes change the weights, so this runs once after
+ * them rather than for every value that is generated. */
+void EmbeddedRispBase::compute_real_format() {
+    double max_abs;
+    int word_bits;
+    int int_bits;
+    unsigned int i;
+    unsigned int j;
+
+    real_fraction_bits = 0;
+    if (!real_is_fixed()) {
+        return;
+    }
+
+    max_abs = std::fabs(min_potential);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        max_abs = std::max(max_abs, std::fabs(ir->neurons[i].threshold));
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            max_abs = std::max(max_abs,
+                               std::fabs(ir->neurons[i].synapses[j].weight));
+        }
+    }
+
+    word_bits = (real_type == "q15") ? 16 : 32;
+    int_bits = 0;
+    while (std::ldexp(1.0, int_bits) <= max_abs) {
+        int_bits++;
+    }
+
+    if (int_bits > word_bits - 1) {
+        throw(std::string) "The network's weights and thresholds do not fit "
+                           "in " + real_type;
+    }
+
+    real_fraction_bits = word_bits - 1 - int_bits;
+}
+
+/* Value v as it is stored in the generated code */
+double EmbeddedRispBase::real_quantize(double v) {
+    double limit;
+    double q;
+
+    if (real_type == "float") {
+        return (double)(float)v;
+    }
+    if (!real_is_fixed()) {
+        return v;
+    }
+
+    limit = std::ldexp(1.0, real_type == "q15" ? 15 : 31) - 1;
+    q = std::round(std::ldexp(v, real_fraction_bits));
+    q = std::max(-limit, std::min(limit, q));
+
+    return std::ldexp(q, -real_fraction_bits);
+}
+
+/* C literal of a weight, threshold or charge in the generated real type */
+std::string EmbeddedRispBase::real_c(double v) {
+    if (real_type == "float") {
+        return std::to_string(v) + "f";
+    }
+    if (real_is_fixed()) {
+        return std::to_string(
+            (long long)std::ldexp(real_quantize(v), real_fraction_bits));
+    }
+    return std::to_string(v);
+}
+
+/* C literal of SPIKE_VALUE_FACTOR. The fixed-point formats store it with
+ * the charges' fraction bits, unclamped since it is only multiplied in the
+ * wider charge_t. */
+std::string EmbeddedRispBase::spike_value_factor_c() {
+    if (real_is_fixed()) {
+        return std::to_string(
+            std::llround(std::ldexp(spike_value_factor, real_fraction_bits)));
+    }
+    return std::to_string(spike_value_factor);
+}
+
+/* weight_t holds weights and thresholds and charge_t holds charges. The
+ * fixed-point formats keep charges in a word twice as wide as the weights so
+ * that sums of weights have headroom. TO_CHARGE converts a value to a charge,
+ * rounding to the nearest fixed-point value, and SPIKE_CHARGE gives the
+ * charge of an input spike. With a fixed-point format only the spike value
+ * is converted; the multiply by SPIKE_VALUE_FACTOR is done in integers. */
+std::string EmbeddedRispBase::gen_real_types_c() {
+    if (real_type == "float") {
+        return "typedef float weight_t; /* Synapse weights and thresholds */\n"
+               "typedef float charge_t; /* Neuron charges */\n"
+               "#define TO_CHARGE(x) ((charge_t)(x))\n"
+               "#define SPIKE_CHARGE(value) TO_CHARGE((value) * "
+               "SPIKE_VALUE_FACTOR)\n";
+    }
+    if (real_is_fixed()) {
+        return std::string("#include <stdint.h>\n"
+                           "\n"
+                           "typedef ") +
+               (real_type == "q15" ? "int16_t" : "int32_t") +
+               " weight_t; /* Synapse weights and thresholds */\n"
+               "typedef " +
+               (real_type == "q15" ? "int32_t" : "int64_t") +
+               " charge_t; /* Neuron charges */\n"
+               "#define CHARGE_FRACTION_BITS (" +
+               std::to_string(real_fraction_bits) +
+               ")\n"
+               "#define CHARGE_ONE ((charge_t)1 << CHARGE_FRACTION_BITS)\n"
+               "#define TO_CHARGE(x) ((charge_t)((x) * CHARGE_ONE + ((x) < 0 "
+               "? -0.5 : 0.5)))\n"
+               "#define SPIKE_CHARGE(value) ((TO_CHARGE(value) * "
+               "SPIKE_VALUE_FACTOR) >> CHARGE_FRACTION_BITS)\n";
+    }
+    return "typedef double weight_t; /* Synapse weights and thresholds */\n"
+           "typedef double charge_t; /* Neuron charges */\n"
+           "#define TO_CHARGE(x) ((charge_t)(x))\n"
+           "#define SPIKE_CHARGE(value) TO_CHARGE((value) * "
+           "SPIKE_VALUE_FACTOR)\n";
+}
+
+/* One line describing the real type and the largest rounding error it
+ * introduces in the network's weights and thresholds */
+std::string EmbeddedRispBase::quantization_report() {
+    double weight_error;
+    double threshold_error;
+    unsigned int i;
+    unsigned int j;
+    double w;
+    char buf[256];
+    std::string format;
+
+    weight_error = 0;
+    threshold_error = std::fabs(min_potential - real_quantize(min_potential));
+    for (i = 0; i < ir->num_neurons(); i++) {
+        threshold_error = std::max(
+            threshold_error, std::fabs(ir->neurons[i].threshold -
+                                       real_quantize(ir->neurons[i].threshold)));
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            w = ir->neurons[i].synapses[j].weight;
+            weight_error = std::max(weight_error, std::fabs(w - real_quantize(w)));
+        }
+    }
+
+    format = real_type;
+    if (real_is_fixed()) {
+        format += " (Q" +
+                  std::to_string((real_type == "q15" ? 15 : 31) -
+                                 real_fraction_bits) +
+                  "." + std::to_string(real_fraction_bits) + ")";
+    }
+
+    snprintf(buf, sizeof(buf),
+             "Real type %s: worst-case quantization error %g in weights and "
+             "%g in thresholds",
+             format.c_str(), weight_error, threshold_error);
+
+    return buf;
+}
+
+/* Marks the neurons that can fire (live: inputs and every neuron a live
+ * neuron's synapse reaches) and the neurons that can receive a charge change
+ * (reached) */
+void EmbeddedRispBase::wcet_reach(std::vector<bool> &live,
+                                  std::vector<bool> &reached) {
+    std::vector<unsigned int> stack;
+    unsigned int i;
+    unsigned int j;
+    unsigned int to;
+
+    live.assign(ir->num_neurons(), false);
+    reached.assign(ir->num_neurons(), false);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (ir->neurons[i].input_id >= 0) {
+            live[i] = true;
+            reached[i] = true;
+            stack.push_back(i);
+        }
+    }
+    while (!stack.empty()) {
+        i = stack.back();
+        stack.pop_back();
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            to = ir->neurons[i].synapses[j].to;
+            reached[to] = true;
+            if (!live[to]) {
+                live[to] = true;
+                stack.push_back(to);
+            }
+        }
+    }
+}
+
+/* Static worst-case work of one timestep of the event-driven sparse backend.
+ * A neuron can only fire if it is an input or a live neuron reaches it, and
+ * each live synapse delivers at most one event per timestep because its
+ * source fires at most once per timestep. Input neurons are assumed to
+ * receive at most one spike per timestep. Backends that scan neurons or
+ * synapses every timestep override this with their own counts. */
+void EmbeddedRispBase::wcet_bounds(unsigned int &events, unsigned int &checks,
+                                   unsigned int &fires,
+                                   unsigned int &synapses) {
+    std::vector<bool> live;
+    std::vector<bool> reached;
+    unsigned int i;
+
+    wcet_reach(live, reached);
+
+    events = ir->num_inputs;
+    checks = 0;
+    fires = 0;
+    synapses = 0;
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (reached[i]) {
+            checks++;
+        }
+        if (live[i]) {
+            fires++;
+            synapses += ir->neurons[i].synapses.size();
+        }
+    }
+    events += synapses;
+}
+
+/* Worst-case operation counts of one timestep and a macro that turns them
+ * into cycles given the cost of each operation on the target */
+std::string EmbeddedRispBase::gen_wcet_c() {
+    unsigned int events;
+    unsigned int checks;
+    unsigned int fires;
+    unsigned int synapses;
+
+    wcet_bounds(events, checks, fires, synapses);
+
+    return "#define WCET_MAX_EVENTS_PER_TIMESTEP (" + std::to_string(events) +
+           ") /* Charge changes applied */\n"
+           "#define WCET_MAX_CHECKS_PER_TIMESTEP (" + std::to_string(checks) +
+           ") /* Neurons tested for a fire */\n"
+           "#define WCET_MAX_FIRES_PER_TIMESTEP (" + std::to_string(fires) +
+           ") /* Neurons fired */\n"
+           "#define WCET_MAX_SYNAPSES_PER_TIMESTEP (" +
+           std::to_string(synapses) +
+           ") /* Synapses or synapse mask words traversed */\n"
+           "/* Worst-case cycles of one timestep, given the measured cycles of "
+           "a timestep with no activity and of each operation above */\n"
+           "#define WCET_TIMESTEP_CYCLES(base, event, check, fire, synapse) "
+           "\\\n"
+           "    ((base) + WCET_MAX_EVENTS_PER_TIMESTEP * (event) + \\\n"
+           "     WCET_MAX_CHECKS_PER_TIMESTEP * (check) + \\\n"
+           "     WCET_MAX_FIRES_PER_TIMESTEP * (fire) + \\\n"
+           "     WCET_MAX_SYNAPSES_PER_TIMESTEP * (synapse))\n";
+}
+
+/* One line with the per-timestep bounds, warning when a profiled event
+ * capacity is below the worst case */
+std::string EmbeddedRispBase::wcet_report() {
+    unsigned int events;
+    unsigned int checks;
+    unsigned int fires;
+    unsigned int synapses;
+    std::string s;
+
+    wcet_bounds(events, checks, fires, synapses);
+
+    s = "WCET bounds per timestep: " + std::to_string(events) +
+        " events, " + std::to_string(checks) + " threshold checks, " +
+        std::to_string(fires) + " fires, " + std::to_string(synapses) +
+        " synapse traversals";
+    if (max_events_per_timestep != 0 && max_events_per_timestep < events) {
+        s += "; MAX_EVENTS_PER_TIMESTEP (" +
+             std::to_string(max_events_per_timestep) +
+             ") is below the event bound, so events can be dropped";
+    }
+
+    return s;
+}
+
+/* Load counters that only exist when the generated code is compiled with
+ * -DSNN_STATS. Otherwise the counting macros expand to nothing, so the
+ * instrumented code costs nothing. */
+std::string EmbeddedRispBase::gen_stats_c() {
+    return "\n"
+           "#ifdef SNN_STATS\n"
+           "/* Activity counted since start or the last snn_reset_stats() */\n"
+           "typedef struct {\n"
+           "    unsigned long events;         /* Charge changes applied */\n"
+           "    unsigned long fires;          /* Neuron fires */\n"
+           "    unsigned long synapses;       /* Outgoing synapses traversed "
+           "*/\n"
+           "    unsigned long dropped_events; /* Events lost to a full "
+           "timestep */\n"
+           "    unsigned long timesteps;      /* Timesteps simulated */\n"
+           "    unsigned long peak_events;    /* Most events queued for one "
+           "timestep */\n"
+           "} SNN_Stats;\n"
+           "\n"
+           "SNN_Stats snn_stats;\n"
+           "\n"
+           "#define SNN_STATS_ADD(field, n) (snn_stats.field += (n))\n"
+           "#define SNN_STATS_MAX(field, n) \\\n"
+           "    do { \\\n"
+           "        if ((unsigned long)(n) > snn_stats.field) { \\\n"
+           "            snn_stats.field = (n); \\\n"
+           "        } \\\n"
+           "    } while (0)\n"
+           "\n"
+           "/* This function will copy the counters into stats. */\n"
+           "void snn_get_stats(SNN_Stats *stats) {\n"
+           "    *stats = snn_stats;\n"
+           "}\n"
+           "\n"
+           "/* This function will set all counters to 0. */\n"
+           "void snn_reset_stats(void) {\n"
+           "    SNN_Stats zero = {0};\n"
+           "\n"
+           "    snn_stats = zero;\n"
+           "}\n"
+           "#else\n"
+           "#define SNN_STATS_ADD(field, n)\n"
+           "#define SNN_STATS_MAX(field, n)\n"
+           "#endif\n";
+}
+
+/* Event-driven backends store the charge change events of each timestep in a
+ * fixed-size array and drop events that do not fit. Every synapse of the
+ * optimized IR delivers at most one event per timestep, and apply_spike()
+ * adds one per input spike, so without a profile the array holds both. */
+std::string EmbeddedRispBase::gen_event_capacity_c() {
+    if (max_events_per_timestep == 0) {
+        return "#define MAX_EVENTS_PER_TIMESTEP (NUM_SYNAPSES + "
+               "NUM_INPUT_NEURONS)\n";
+    }
+
+    return "#define MAX_EVENTS_PER_TIMESTEP (" +
+           std::to_string(max_events_per_timestep) + ")\n";
+}
+
+/* Input/output index tables. The NEURON_IND tables index the generated
+ * neuron arrays; the NODE_ID tables give the ids from the network JSON, which
+ * stay stable when passes remove or reorder neurons. */
+std::string EmbeddedRispBase::gen_io_tables_c() {
+    IndentString s;
+    std::vector<unsigned int> input_ind_to_neuron_ind;
+    std::vector<unsigned int> output_ind_to_neuron_ind;
+    unsigned int i;
+
+    input_ind_to_neuron_ind = ir->input_ind_to_neuron_ind();
+    output_ind_to_neuron_ind = ir->output_ind_to_neuron_ind();
+
+    s = "const unsigned int INPUT_IND_TO_NEURON_IND[NUM_INPUT_NEURONS] = {";
+
+    for (i = 0; i < input_ind_to_neuron_ind.size(); i++) {
+        s += std::to_string(input_ind_to_neuron_ind[i]);
+        if (i != input_ind_to_neuron_ind.size() - 1) {
+            s += ", ";
+        }
+    }
+
+    s += "};\nconst unsigned int OUTPUT_IND_TO_NEURON_IND[NUM_OUTPUT_NEURONS] "
+         "= {";
+
+    for (i = 0; i < output_ind_to_neuron_ind.size(); i++) {
+        s += std::to_string(output_ind_to_neuron_ind[i]);
+        if (i != output_ind_to_neuron_ind.size() - 1) {
+            s += ", ";
+        }
+    }
+
+    s += "};\nconst unsigned int INPUT_IND_TO_NODE_ID[NUM_INPUT_NEURONS] = {";
+
+    for (i = 0; i < input_ind_to_neuron_ind.size(); i++) {
+        s += std::to_string(ir->neurons[input_ind_to_neuron_ind[i]].id);
+        if (i != input_ind_to_neuron_ind.size() - 1) {
+            s += ", ";
+        }
+    }
+
+    s += "};\nconst unsigned int OUTPUT_IND_TO_NODE_ID[NUM_OUTPUT_NEURONS] = {";
+
+    for (i = 0; i < output_ind_to_neuron_ind.size(); i++) {
+        s += std::to_string(ir->neurons[output_ind_to_neuron_ind[i]].id);
+        if (i != output_ind_to_neuron_ind.size() - 1) {
+            s += ", ";
+        }
+    }
+
+    s += "};\n";
+
+    return s.get_str();
+}
+
+/* Computes run_time, the last timestep index simulated by run(duration) */
+std::string EmbeddedRispBase::gen_run_time_c() {
+    IndentString s;
+    std::string ret;
+
+    /* run_until() reports how many timesteps it simulated */
+    ret = run_until ? "return 0;\n" : "return;\n";
+
+    s = "/* Ensure run_time is not negative */\n";
+
+    if (run_time_inclusive) {
+        s += "if (duration < 0) {\n"
+             "    " + ret +
+             "}\n"
+             "\n"
+             "run_time = (unsigned int)duration;\n";
+    } else {
+        s += "if (duration-1 < 0) {\n"
+             "    " + ret +
+             "}\n"
+             "\n"
+             "run_time = (unsigned int)(duration-1);\n";
+    }
+
+    return s.get_str();
+}
+
+/* Single-producer/single-consumer input ring. enqueue_spike() is the only
+ * writer of spike_queue_head and run() the only writer of spike_queue_tail,
+ * so an ISR or another thread can add spikes while run() executes without
+ * either side masking interrupts. The barrier orders the slot contents
+ * against the index that publishes them. One slot stays empty to tell a full
+ * queue from an empty one. */
+std::string EmbeddedRispBase::gen_spike_queue_c() {
+    IndentString s;
+
+    if (spike_queue_size == 0) {
+        return "";
+    }
+
+    s = "#define SPIKE_QUEUE_SIZE (" + std::to_string(spike_queue_size) +
+        ")\n"
+        "\n"
+        "#if defined(__GNUC__) || defined(__clang__)\n"
+        "#define SPIKE_QUEUE_BARRIER() __sync_synchronize()\n"
+        "#else\n"
+        "#define SPIKE_QUEUE_BARRIER()\n"
+        "#endif\n"
+        "\n"
+        "/* Input spike waiting in the queue */\n"
+        "typedef struct {\n"
+        "    unsigned int input_ind; /* Input neuron zero-based index */\n"
+        "    unsigned int time;      /* Time relative to the timestep that "
+        "drains it */\n"
+        "    double value;           /* Spike value */\n"
+        "} Queued_Spike;\n"
+        "\n"
+        "Queued_Spike spike_queue[SPIKE_QUEUE_SIZE];     /* Ring of queued "
+        "input spikes */\n"
+        "volatile unsigned int spike_queue_head = 0;     /* Next slot to "
+        "fill, written only by enqueue_spike() */\n"
+        "volatile unsigned int spike_queue_tail = 0;     /* Next slot to "
+        "drain, written only by run() */\n"
+        "\n"
+        "/* This function will queue a spike of potential value value for the "
+        "input neuron with an input neuron zero-based index of input_ind. It "
+        "may be called from an interrupt handler or another thread while run() "
+        "executes; run() applies queued spikes at the start of its next "
+        "timestep, at time time relative to that timestep. Returns 1 if the "
+        "spike was queued and 0 if the queue is full. */\n"
+        "int enqueue_spike(unsigned int input_ind, unsigned int time, double "
+        "value) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int head;\n"
+         "unsigned int next;\n"
+         "\n"
+         "head = spike_queue_head;\n"
+         "next = head + 1;\n"
+         "if (next == SPIKE_QUEUE_SIZE) {\n"
+         "    next = 0;\n"
+         "}\n"
+         "if (next == spike_queue_tail) {\n"
+         "    return 0;\n"
+         "}\n"
+         "\n"
+         "spike_queue[head].input_ind = input_ind;\n"
+         "spike_queue[head].time = time;\n"
+         "spike_queue[head].value = value;\n"
+         "\n"
+         "/* Publish the slot only after its contents are written */\n"
+         "SPIKE_QUEUE_BARRIER();\n"
+         "spike_queue_head = next;\n"
+         "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* Statement block for the top of run()'s timestep loop that moves every
+ * queued spike into the network through apply_spike() */
+std::string EmbeddedRispBase::gen_spike_queue_drain_c() {
+    if (spike_queue_size == 0) {
+        return "";
+    }
+
+    return "/* Apply spikes queued by enqueue_spike() */\n"
+           "while (spike_queue_tail != spike_queue_head) {\n"
+           "    SPIKE_QUEUE_BARRIER();\n"
+           "    apply_spike(spike_queue[spike_queue_tail].input_ind,\n"
+           "                spike_queue[spike_queue_tail].time,\n"
+           "                spike_queue[spike_queue_tail].value);\n"
+           "    SPIKE_QUEUE_BARRIER();\n"
+           "    if (spike_queue_tail + 1 == SPIKE_QUEUE_SIZE) {\n"
+           "        spike_queue_tail = 0;\n"
+           "    } else {\n"
+           "        spike_queue_tail = spike_queue_tail + 1;\n"
+           "    }\n"
+           "}\n";
+}
+
+/* Callback that run() invokes for every output fire, so applications can
+ * react without waiting for run() to return */
+std::string EmbeddedRispBase::gen_output_callback_c() {
+    if (!output_callback) {
+        return "";
+    }
+
+    return "/* Function called with the output neuron zero-based index and "
+           "the timestep of every output fire, relative to the start of the "
+           "run() call in progress */\n"
+           "typedef void (*Output_Callback)(unsigned int output_ind, "
+           "unsigned int time);\n"
+           "\n"
+           "Output_Callback output_callback = 0;\n"
+           "\n"
+           "/* This function will set the function that run() calls at the "
+           "end of each timestep for every output neuron that fired in it. "
+           "Pass 0 to stop the calls. */\n"
+           "void set_output_callback(Output_Callback callback) {\n"
+           "    output_callback = callback;\n"
+           "}\n";
+}
+
+/* Statement block for the end of run()'s timestep loop that passes this
+ * timestep's output fires to the callback. last_fire is the backend's C
+ * expression for the last fire time of output index i. */
+std::string EmbeddedRispBase::gen_output_callback_call_c(
+    const std::string &last_fire) {
+    if (!output_callback) {
+        return "";
+    }
+
+    return "/* Report this timestep's output fires */\n"
+           "if (output_callback != 0) {\n"
+           "    for (i = 0; i < NUM_OUTPUT_NEURONS; i++) {\n"
+           "        if (" + last_fire + " == (int)time) {\n"
+           "            output_callback(i, time);\n"
+           "        }\n"
+           "    }\n"
+           "}\n";
+}
+
+/* Comment and opening line of the run loop. With --run-until the loop is
+ * generated as run_until() and run() becomes a wrapper around it. */
+std::string EmbeddedRispBase::gen_run_header_c() {
+    if (!run_until) {
+        return "/* This function will run the SNN for duration, the specified "
+               "number of timesteps (many neuroprocessors only support "
+               "discrete timesteps, such as RISP). */\n"
+               "void run(double duration) {\n";
+    }
+
+    return "/* This function will run the SNN like run(duration), but stops "
+           "after the first timestep at the end of which a condition in "
+           "stop_when holds: STOP_ON_ANY_OUTPUT once any output neuron fires, "
+           "STOP_ON_OUTPUT_COUNT once the output neuron with zero-based index "
+           "stop_output_ind has fired stop_count times during this call, and "
+           "STOP_ON_QUIESCENT once no spikes are left in flight. It returns "
+           "the number of timesteps simulated. */\n"
+           "unsigned int run_until(double duration, unsigned int stop_when,\n"
+           "                       unsigned int stop_output_ind, "
+           "unsigned int stop_count) {\n";
+}
+
+/* Stop condition flags of run_until() */
+std::string EmbeddedRispBase::gen_run_until_defines_c() {
+    return "#define STOP_ON_ANY_OUTPUT (1)\n"
+           "#define STOP_ON_OUTPUT_COUNT (2)\n"
+           "#define STOP_ON_QUIESCENT (4)\n";
+}
+
+/* Statement block for the very end of run_until()'s timestep loop, after the
+ * ring buffers have moved on to the next timestep. last_fire and fire_count
+ * are the backend's C expressions for the last fire time and fire count of
+ * output index i; network_quiescent() is emitted by the backend. */
+std::string EmbeddedRispBase::gen_run_until_check_c(
+    const std::string &last_fire, const std::string &fire_count) {
+    std::string quiescent;
+
+    quiescent = "network_quiescent()";
+    if (spike_queue_size > 0) {
+        quiescent = "spike_queue_tail == spike_queue_head &&\n"
+                    "         " + quiescent;
+    }
+
+    return "/* Stop early once a requested condition holds */\n"
+           "if (stop_when != 0) {\n"
+           "    i = NUM_OUTPUT_NEURONS;\n"
+           "    if ((stop_when & STOP_ON_ANY_OUTPUT) != 0) {\n"
+           "        for (i = 0; i < NUM_OUTPUT_NEURONS; i++) {\n"
+           "            if (" + last_fire + " == (int)time) {\n"
+           "                break;\n"
+           "            }\n"
+           "        }\n"
+           "    }\n"
+           "    if (i < NUM_OUTPUT_NEURONS) {\n"
+           "        /* Count this timestep before leaving the loop */\n"
+           "        time++;\n"
+           "        break;\n"
+           "    }\n"
+           "\n"
+           "    i = stop_output_ind;\n"
+           "    if ((stop_when & STOP_ON_OUTPUT_COUNT) != 0 &&\n"
+           "        i < NUM_OUTPUT_NEURONS && " + fire_count +
+           " >= stop_count) {\n"
+           "        time++;\n"
+           "        break;\n"
+           "    }\n"
+           "\n"
+           "    if ((stop_when & STOP_ON_QUIESCENT) != 0 &&\n"
+           "        " + quiescent + ") {\n"
+           "        time++;\n"
+           "        break;\n"
+           "    }\n"
+           "}\n";
+}
+
+/* run() as a wrapper of run_until() that never stops early */
+std::string EmbeddedRispBase::gen_run_until_wrapper_c() {
+    return "/* This function will run the SNN for duration, the specified "
+           "number of timesteps (many neuroprocessors only support discrete "
+           "timesteps, such as RISP). */\n"
+           "void run(double duration) {\n"
+           "    run_until(duration, 0, 0, 0);\n"
+           "}\n";
+}
+
+/* Fixed-rate driver layered on apply_spike(), run() and output_count(). The
+ * application fills the input frame returned by tick_input_frame() while
+ * tick() simulates with the other one, and reads the outputs of the latest
+ * tick from tick_output_frame() while the next tick fills the other output
+ * frame. */
+std::string EmbeddedRispBase::gen_tick_c() {
+    IndentString s;
+
+    s = "/* Input spike value of every input neuron for one tick, 0 for no "
+        "spike */\n"
+        "typedef struct {\n"
+        "    double value[NUM_INPUT_NEURONS];\n"
+        "} Input_Frame;\n"
+        "\n"
+        "/* Output fires of one tick */\n"
+        "typedef struct {\n"
+        "    unsigned int fire_count[NUM_OUTPUT_NEURONS];\n"
+        "    unsigned long tick;                          /* Tick that "
+        "produced the frame */\n"
+        "} Output_Frame;\n"
+        "\n"
+        "Input_Frame tick_input_frames[2];\n"
+        "Output_Frame tick_output_frames[2];\n"
+        "volatile unsigned int tick_input_fill = 0;       /* Input frame the "
+        "application fills */\n"
+        "volatile unsigned int tick_output_latest = 0;    /* Output frame of "
+        "the latest tick */\n"
+        "unsigned long tick_count = 0;                    /* Ticks since "
+        "start */\n"
+        "unsigned long tick_deadline_misses = 0;          /* Ticks that took "
+        "longer than the budget */\n"
+        "unsigned long tick_worst_cycles = 0;             /* Longest tick "
+        "measured */\n"
+        "unsigned long (*tick_cycle_counter)(void) = 0;\n"
+        "unsigned long tick_budget_cycles = 0;\n"
+        "\n"
+        "/* This function will set the cycle counter that tick() measures "
+        "itself with and the number of cycles a tick may take. Ticks that "
+        "take longer are counted in tick_deadline_misses. Pass 0 as counter "
+        "to stop measuring. */\n"
+        "void set_tick_budget(unsigned long (*counter)(void), unsigned long "
+        "budget_cycles) {\n"
+        "    tick_cycle_counter = counter;\n"
+        "    tick_budget_cycles = budget_cycles;\n"
+        "}\n"
+        "\n"
+        "/* This function will return the input frame that the next tick() "
+        "latches. */\n"
+        "Input_Frame *tick_input_frame() {\n"
+        "    return &tick_input_frames[tick_input_fill];\n"
+        "}\n"
+        "\n"
+        "/* This function will return the output frame of the latest "
+        "tick(). */\n"
+        "const Output_Frame *tick_output_frame() {\n"
+        "    return &tick_output_frames[tick_output_latest];\n"
+        "}\n"
+        "\n"
+        "/* This function will advance the SNN by exactly one timestep. It "
+        "latches and clears the filled input frame, runs the timestep and "
+        "publishes its output fires. Returns 0 if the tick missed its "
+        "budget and 1 otherwise. */\n"
+        "int tick() {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int frame;\n"
+         "unsigned long start;\n"
+         "unsigned long cycles;\n"
+         "\n"
+         "start = 0;\n"
+         "if (tick_cycle_counter != 0) {\n"
+         "    start = tick_cycle_counter();\n"
+         "}\n"
+         "\n"
+         "/* Hand the application the other input frame and latch this one */\n"
+         "frame = tick_input_fill;\n"
+         "tick_input_fill = 1 - frame;\n"
+         "for (i = 0; i < NUM_INPUT_NEURONS; i++) {\n"
+         "    if (tick_input_frames[frame].value[i] != 0) {\n"
+         "        apply_spike(i, 0, tick_input_frames[frame].value[i]);\n"
+         "        tick_input_frames[frame].value[i] = 0;\n"
+         "    }\n"
+         "}\n"
+         "\n";
+
+    s += std::string("run(") + (run_time_inclusive ? "0" : "1") + ");\n";
+
+    s += "\n"
+         "/* Fill the output frame the application is not reading and "
+         "publish it */\n"
+         "frame = 1 - tick_output_latest;\n"
+         "for (i = 0; i < NUM_OUTPUT_NEURONS; i++) {\n"
+         "    tick_output_frames[frame].fire_count[i] = output_count(i);\n"
+         "}\n"
+         "tick_output_frames[frame].tick = tick_count;\n"
+         "tick_output_latest = frame;\n"
+         "tick_count++;\n"
+         "\n"
+         "if (tick_cycle_counter == 0) {\n"
+         "    return 1;\n"
+         "}\n"
+         "cycles = tick_cycle_counter() - start;\n"
+         "if (cycles > tick_worst_cycles) {\n"
+         "    tick_worst_cycles = cycles;\n"
+         "}\n"
+         "if (tick_budget_cycles != 0 && cycles > tick_budget_cycles) {\n"
+         "    tick_deadline_misses++;\n"
+         "    return 0;\n"
+         "}\n"
+         "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
@@ -0,0 +1,624 @@
+#include "EmbeddedRispBinary.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+#include <map>
+
+EmbeddedRispBinary::EmbeddedRispBinary(neuro::json &params)
+    : EmbeddedRisp(params) {}
+
+EmbeddedRispBinary::~EmbeddedRispBinary() {}
+
+/* True if every synapse weight is -1, 0 or 1 */
+bool EmbeddedRispBinary::binary_weights() {
+    unsigned int i;
+    unsigned int j;
+    double w;
+
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            w = ir->neurons[i].synapses[j].weight;
+            if (w != -1 && w != 0 && w != 1) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Groups every neuron's incoming synapses by (delay, fire bitset word) and
+ * sets the source's bit in the positive, negative and any masks. Entries of a
+ * neuron are contiguous and end at neuron_entry_end[neuron]. */
+void EmbeddedRispBinary::build_masks() {
+    std::vector<std::map<std::pair<unsigned int, unsigned int>, MaskEntry>> in;
+    std::map<std::pair<unsigned int, unsigned int>, MaskEntry>::iterator it;
+    const IRSynapse *syn;
+    unsigned long long bit;
+    MaskEntry *e;
+    unsigned int i;
+    unsigned int j;
+
+    in.resize(ir->num_neurons());
+    for (i = 0; i < ir->num_neurons(); i++) {
+        bit = 1ULL << (i % 64);
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            syn = &ir->neurons[i].synapses[j];
+            e = &in[syn->to][std::make_pair(syn->delay, i / 64)];
+            e->delay = syn->delay;
+            e->word = i / 64;
+            if (syn->weight > 0) {
+                e->pos |= bit;
+            } else if (syn->weight < 0) {
+                e->neg |= bit;
+            }
+            e->any |= bit;
+        }
+    }
+
+    mask_entries.clear();
+    neuron_entry_end.clear();
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (it = in[i].begin(); it != in[i].end(); it++) {
+            mask_entries.push_back(it->second);
+        }
+        neuron_entry_end.push_back(mask_entries.size());
+    }
+}
+
+/* Every timestep visits every neuron and ANDs every mask word, which is
+ * counted as a synapse traversal. The sparse fallback keeps the event-driven
+ * counts. */
+void EmbeddedRispBinary::wcet_bounds(unsigned int &events,
+                                     unsigned int &checks,
+                                     unsigned int &fires,
+                                     unsigned int &synapses) {
+    EmbeddedRisp::wcet_bounds(events, checks, fires, synapses);
+    if (fire_like_ravens || !binary_weights()) {
+        return;
+    }
+
+    build_masks();
+    checks = ir->num_neurons();
+    synapses = mask_entries.size();
+}
+
+std::string EmbeddedRispBinary::gen_static_c(unsigned int max_num_timesteps) {
+    IndentString s;
+    unsigned int i;
+    unsigned int num_fire_words;
+
+    if (fire_like_ravens) {
+        fprintf(stderr, "Warning: EmbeddedRispBinary does not support the "
+                        "fire_like_ravens flag, generating sparse RISP code "
+                        "instead.\n");
+        return EmbeddedRisp::gen_static_c(max_num_timesteps);
+    }
+
+    if (!binary_weights()) {
+        fprintf(stderr, "Warning: EmbeddedRispBinary needs all synapse weights "
+                        "to be -1, 0 or 1, generating sparse RISP code "
+                        "instead.\n");
+        return EmbeddedRisp::gen_static_c(max_num_timesteps);
+    }
+
+    build_masks();
+    num_fire_words = (ir->num_neurons() + 63) / 64;
+
+    s = "/*************** RISP BINARY NETWORK CODE ********************/\n"
+        "\n" +
+        gen_defines_c(max_num_timesteps) + "#define NUM_FIRE_WORDS (" +
+        std::to_string(std::max(num_fire_words, 1u)) +
+        ")\n"
+        "#define NUM_MASK_ENTRIES (" +
+        std::to_string(std::max((unsigned int)mask_entries.size(), 1u)) +
+        ")\n"
+        "\n"
+        "/* Number of set bits in a 64-bit word */\n"
+        "#if defined(__GNUC__) || defined(__clang__)\n"
+        "#define POPCOUNT64(x) ((unsigned int)__builtin_popcountll(x))\n"
+        "#else\n"
+        "static unsigned int popcount64(unsigned long long x) {\n"
+        "    x = x - ((x >> 1) & 0x5555555555555555ULL);\n"
+        "    x = (x & 0x3333333333333333ULL) + ((x >> 2) & "
+        "0x3333333333333333ULL);\n"
+        "    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;\n"
+        "    return (unsigned int)((x * 0x0101010101010101ULL) >> 56);\n"
+        "}\n"
+        "#define POPCOUNT64(x) popcount64(x)\n"
+        "#endif\n"
+        "\n";
+
+    s += gen_io_tables_c();
+
+    s += "\n"
+         "/* Incoming synapses of a neuron that share a delay and a word of the "
+         "fire bitset. Bit b of a mask stands for neuron word * 64 + b. */\n"
+         "typedef struct {\n"
+         "    unsigned int delay;\n"
+         "    unsigned int word;\n"
+         "    unsigned long long pos; /* Sources with weight 1 */\n"
+         "    unsigned long long neg; /* Sources with weight -1 */\n"
+         "    unsigned long long any; /* All sources, including weight 0 */\n"
+         "} Mask_Entry;\n"
+         "\n"
+         "const Mask_Entry mask_entries[NUM_MASK_ENTRIES] = {\n";
+
+    s.add_indent_spaces(4);
+    for (i = 0; i < mask_entries.size(); i++) {
+        s += "{" + std::to_string(mask_entries[i].delay) + ", " +
+             std::to_string(mask_entries[i].word) + ", " +
+             std::to_string(mask_entries[i].pos) + "ULL, " +
+             std::to_string(mask_entries[i].neg) + "ULL, " +
+             std::to_string(mask_entries[i].any) + "ULL}";
+        if (i != mask_entries.size() - 1) {
+            s += ",";
+        }
+        s += "\n";
+    }
+    if (mask_entries.empty()) {
+        s += "{0, 0, 0ULL, 0ULL, 0ULL}\n";
+    }
+    s.add_indent_spaces(-4);
+
+    s += "};\n"
+         "\n"
+         "/* End of each neuron's entries in mask_entries */\n"
+         "const unsigned int neuron_entry_end[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < neuron_entry_end.size(); i++) {
+        s += std::to_string(neuron_entry_end[i]);
+        if (i != neuron_entry_end.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "const weight_t neuron_threshold[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < ir->num_neurons(); i++) {
+        s += real_c(ir->neurons[i].threshold);
+        if (i != ir->num_neurons() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "/* Input neuron index of each neuron, -1 if it is not an input */\n"
+         "const int neuron_input_ind[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < ir->num_neurons(); i++) {
+        s += std::to_string(ir->neurons[i].input_id);
+        if (i != ir->num_neurons() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    if (ir->has_leak()) {
+        s += "\n"
+             "const unsigned char neuron_leak[NUM_NEURONS] = {\n    ";
+        for (i = 0; i < ir->num_neurons(); i++) {
+            s += std::to_string((unsigned char)ir->neurons[i].leak);
+            if (i != ir->num_neurons() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+    }
+
+    s += "\n"
+         "charge_t neuron_charge[NUM_NEURONS] = {0};                    "
+         "/* Charge of every neuron */\n"
+         "unsigned int neuron_fire_counts[NUM_NEURONS] = {0};           "
+         "/* Fires of every neuron during the last run */\n"
+         "int neuron_last_fires[NUM_NEURONS];                           "
+         "/* Last fire time of every neuron during the last run */\n"
+         "unsigned long long fired[MAX_NUM_TIMESTEPS][NUM_FIRE_WORDS];  "
+         "/* Bitset of the neurons that fired, keyed on timestep */\n"
+         "unsigned int cur_slot = 0;                                    "
+         "/* Row of the ring arrays for the upcoming timestep */\n"
+         "charge_t input_charge[MAX_NUM_TIMESTEPS][NUM_INPUT_NEURONS];  "
+         "/* Pending input spike charge keyed on timestep */\n"
+         "unsigned char input_active[MAX_NUM_TIMESTEPS][NUM_INPUT_NEURONS]; "
+         "/* Whether an input spike is pending */\n"
+         "\n";
+
+    s += gen_apply_spike_c() + "\n";
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_c() + "\n";
+    }
+    if (output_callback) {
+        s += gen_output_callback_c() + "\n";
+    }
+    if (run_until) {
+        s += gen_run_until_defines_c() + "\n" + gen_network_quiescent_c() +
+             "\n";
+    }
+    s += gen_run_c() + "\n";
+    if (run_until) {
+        s += gen_run_until_wrapper_c() + "\n";
+    }
+    s += gen_clear_activity_c() + "\n";
+    s += gen_output_last_fire_c() + "\n";
+    s += gen_output_count_c();
+    if (tick) {
+        s += "\n" + gen_tick_c();
+    }
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispBinary::gen_apply_spike_c() {
+    IndentString s;
+
+    s = "/* This function will apply a spike of potential value value to the "
+        "input neuron with an input neuron zero-based index of input_ind at "
+        "time time relative to the current timestep of the neuroprocessor. */\n"
+        "void apply_spike(unsigned int input_ind, unsigned int time, double "
+        "value) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int slot;\n"
+         "\n"
+         "/* Ensure input neuron index is not out of bounds */\n"
+         "if (input_ind >= NUM_INPUT_NEURONS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "/* Ensure time is not out of bounds */\n"
+         "if (time >= MAX_NUM_TIMESTEPS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "slot = cur_slot + time;\n"
+         "if (slot >= MAX_NUM_TIMESTEPS) {\n"
+         "    slot -= MAX_NUM_TIMESTEPS;\n"
+         "}\n"
+         "\n"
+         "input_charge[slot][input_ind] += SPIKE_CHARGE(value);\n"
+         "input_active[slot][input_ind] = 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* Every timestep, each neuron ANDs the fire bitset of timestep (now - delay)
+ * with its masks. The popcounts of the positive and negative matches are its
+ * charge and any match at all (or a pending input spike) is an event, which
+ * leaks, clamps and threshold-checks the neuron exactly like the sparse
+ * backend. Delays are at least 1, so the neurons may be visited in any
+ * order. */
+std::string EmbeddedRispBinary::gen_run_c() {
+    IndentString s;
+    bool net_has_leak;
+
+    net_has_leak = ir->has_leak();
+
+    s = gen_run_header_c();
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int time;\n"
+         "unsigned int i;\n"
+         "unsigned int e;\n"
+         "unsigned int src_slot;\n"
+         "unsigned int run_time;\n"
+         "unsigned int pos;\n"
+         "unsigned int neg;\n"
+         "unsigned long long spikes;\n"
+         "unsigned long long event;\n"
+         "int input_ind;\n"
+         "\n"
+         "/* Clear tracking info on all neurons */\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n"
+         "    neuron_last_fires[i] = -1;\n"
+         "    neuron_fire_counts[i] = 0;\n"
+         "}\n"
+         "\n";
+
+    s += gen_run_time_c();
+
+    s += "\n"
+         "for (time = 0; time <= run_time; time++) {\n";
+
+    s.add_indent_spaces(4);
+
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_drain_c() + "\n";
+    }
+
+    s += "/* The slot was last written MAX_NUM_TIMESTEPS timesteps ago */\n"
+         "for (i = 0; i < NUM_FIRE_WORDS; i++) {\n"
+         "    fired[cur_slot][i] = 0;\n"
+         "}\n"
+         "\n"
+         "e = 0;\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "pos = 0;\n"
+         "neg = 0;\n"
+         "event = 0;\n"
+         "for (; e < neuron_entry_end[i]; e++) {\n"
+         "    src_slot = cur_slot + MAX_NUM_TIMESTEPS - mask_entries[e].delay;\n"
+         "    if (src_slot >= MAX_NUM_TIMESTEPS) {\n"
+         "        src_slot -= MAX_NUM_TIMESTEPS;\n"
+         "    }\n"
+         "    spikes = fired[src_slot][mask_entries[e].word];\n"
+         "    pos += POPCOUNT64(spikes & mask_entries[e].pos);\n"
+         "    neg += POPCOUNT64(spikes & mask_entries[e].neg);\n"
+         "    event |= spikes & mask_entries[e].any;\n"
+         "}\n"
+         "\n"
+         "input_ind = neuron_input_ind[i];\n"
+         "if (input_ind >= 0 && input_active[cur_slot][input_ind]) {\n"
+         "    event = 1;\n"
+         "}\n"
+         "\n"
+         "if (event == 0) {\n"
+         "    continue;\n"
+         "}\n"
+         "SNN_STATS_ADD(events, pos + neg);\n"
+         "\n";
+
+    if (net_has_leak) {
+        s += "if (neuron_leak[i] == 1) {\n"
+             "    neuron_charge[i] = 0;\n"
+             "}\n";
+    }
+
+    s += "if (neuron_charge[i] < MIN_POTENTIAL) {\n"
+         "    neuron_charge[i] = MIN_POTENTIAL;\n"
+         "}\n"
+         "if (input_ind >= 0) {\n"
+         "    neuron_charge[i] += input_charge[cur_slot][input_ind];\n"
+         "    SNN_STATS_ADD(events, input_active[cur_slot][input_ind]);\n"
+         "}\n";
+
+    /* Synapse weights are +-1, so the popcounts are the charge in units of
+     * one */
+    if (real_is_fixed()) {
+        s += "neuron_charge[i] += ((charge_t)pos - (charge_t)neg) * "
+             "CHARGE_ONE;\n"
+             "\n";
+    } else {
+        s += "neuron_charge[i] += (int)pos - (int)neg;\n"
+             "\n";
+    }
+
+    if (threshold_inclusive) {
+        s += "if (neuron_charge[i] >= neuron_threshold[i]) {\n";
+    } else {
+        s += "if (neuron_charge[i] > neuron_threshold[i]) {\n";
+    }
+
+    s += "    neuron_charge[i] = 0;\n"
+         "    SNN_STATS_ADD(fires, 1);\n"
+         "    fired[cur_slot][i >> 6] |= 1ULL << (i & 63);\n"
+         "    neuron_fire_counts[i]++;\n"
+         "    neuron_last_fires[i] = time;\n"
+         "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n"
+         "\n";
+
+    if (output_callback) {
+        s += gen_output_callback_call_c(
+                 "neuron_last_fires[OUTPUT_IND_TO_NEURON_IND[i]]") + "\n";
+    }
+
+    s += "/* Consume this timestep's input spikes */\n"
+         "for (i = 0; i < NUM_INPUT_NEURONS; i++) {\n"
+         "    input_charge[cur_slot][i] = 0;\n"
+         "    input_active[cur_slot][i] = 0;\n"
+         "}\n"
+         "cur_slot++;\n"
+         "if (cur_slot == MAX_NUM_TIMESTEPS) {\n"
+         "    cur_slot = 0;\n"
+         "}\n"
+         "SNN_STATS_ADD(timesteps, 1);\n";
+
+    if (run_until) {
+        s += "\n" +
+             gen_run_until_check_c(
+                 "neuron_last_fires[OUTPUT_IND_TO_NEURON_IND[i]]",
+                 "neuron_fire_counts[OUTPUT_IND_TO_NEURON_IND[i]]");
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n"
+         "\n";
+
+    if (net_has_leak) {
+        s += "/* Apply leak and reset minimum charge before the next run */\n";
+    } else {
+        s += "/* Reset minimum charge before the next run */\n";
+    }
+
+    s += "for (i = 0; i < NUM_NEURONS; i++) {\n";
+
+    s.add_indent_spaces(4);
+
+    if (net_has_leak) {
+        s += "if (neuron_leak[i] == 1) {\n"
+             "    neuron_charge[i] = 0;\n"
+             "}\n";
+    }
+
+    s += "if (neuron_charge[i] < MIN_POTENTIAL) {\n"
+         "    neuron_charge[i] = MIN_POTENTIAL;\n"
+         "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    if (run_until) {
+        s += "\n"
+             "return time;\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* A fire is in flight until the longest synapse delay has passed, so only
+ * the ring slots of the last max_delay timesteps are checked, and only for
+ * neurons with outgoing synapses. This ignores each neuron's own delays and
+ * may report quiescence a few timesteps late. */
+std::string EmbeddedRispBinary::gen_network_quiescent_c() {
+    IndentString s;
+    std::vector<unsigned long long> senders;
+    unsigned int i;
+
+    senders.assign(std::max((ir->num_neurons() + 63) / 64, 1u), 0);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (!ir->neurons[i].synapses.empty()) {
+            senders[i >> 6] |= 1ULL << (i & 63);
+        }
+    }
+
+    s = "/* Bitset of the neurons with outgoing synapses, the only ones whose "
+        "fires can be in flight */\n"
+        "const unsigned long long fire_senders[NUM_FIRE_WORDS] = {\n    ";
+    for (i = 0; i < senders.size(); i++) {
+        s += std::to_string(senders[i]) + "ULL";
+        if (i != senders.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "/* This function will return 1 if no spikes are in flight in the SNN "
+         "and 0 otherwise. */\n"
+         "int network_quiescent(void) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "unsigned int slot;\n"
+         "\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    for (j = 0; j < NUM_INPUT_NEURONS; j++) {\n"
+         "        if (input_active[i][j]) {\n"
+         "            return 0;\n"
+         "        }\n"
+         "    }\n"
+         "}\n"
+         "\n"
+         "for (i = 1; i <= " + std::to_string(ir->max_delay()) + "; i++) {\n"
+         "    slot = (cur_slot + MAX_NUM_TIMESTEPS - i) % MAX_NUM_TIMESTEPS;\n"
+         "    for (j = 0; j < NUM_FIRE_WORDS; j++) {\n"
+         "        if ((fired[slot][j] & fire_senders[j]) != 0) {\n"
+         "            return 0;\n"
+         "        }\n"
+         "    }\n"
+         "}\n"
+         "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispBinary::gen_clear_activity_c() {
+    IndentString s;
+
+    s = "/* This function will clear the SNN of all activity. It resets all "
+        "neuron and synapse state. */\n"
+        "void clear_activity() {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "\n"
+         "/* Clear activity-related neuron state */\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n"
+         "    neuron_charge[i] = 0;\n"
+         "    neuron_last_fires[i] = -1;\n"
+         "    neuron_fire_counts[i] = 0;\n"
+         "}\n"
+         "\n"
+         "/* Clear all spikes in flight */\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    for (j = 0; j < NUM_FIRE_WORDS; j++) {\n"
+         "        fired[i][j] = 0;\n"
+         "    }\n"
+         "    for (j = 0; j < NUM_INPUT_NEURONS; j++) {\n"
+         "        input_charge[i][j] = 0;\n"
+         "        input_active[i][j] = 0;\n"
+         "    }\n"
+         "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispBinary::gen_output_last_fire_c() {
+    IndentString s;
+
+    s = "/* This function will return the timestep of the output neuron with "
+        "an output neuron zero-based index of output_ind. The returned "
+        "timestep will only be for the most recent call of the run() function. "
+        "*/\n"
+        "double output_last_fire(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return -1;\n"
+         "}\n"
+         "\n"
+         "return (double)neuron_last_fires[OUTPUT_IND_TO_NEURON_IND"
+         "[output_ind]];\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispBinary::gen_output_count_c() {
+    IndentString s;
+
+    s = "/* This function will return the number of neuronal fires for the "
+        "output neuron with an output neuron zero-based index of output_ind. "
+        "The returned fire count will only be for the most recent call of the "
+        "run() function. */\n"
+        "unsigned int output_count(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return 0;\n"
+         "}\n"
+         "\n"
+         "return neuron_fire_counts[OUTPUT_IND_TO_NEURON_IND[output_ind]];\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
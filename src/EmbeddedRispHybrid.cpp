@@ -0,0 +1,953 @@
+#include "EmbeddedRispHybrid.hpp"
+#include "helpers.hpp"
+
+EmbeddedRispHybrid::EmbeddedRispHybrid(neuro::json &params)
+    : EmbeddedRispBase(params) {}
+
+EmbeddedRispHybrid::~EmbeddedRispHybrid() {}
+
+/* Neurons that sit on a recurrent loop (a strongly connected component with
+ * more than one neuron, or a neuron with a synapse to itself) keep spikes
+ * circulating and are expected to be active on most timesteps, so they are
+ * placed in the dense "hot" partition. Everything else is simulated with the
+ * event queue. Components are found with an iterative Tarjan's algorithm so
+ * that large networks do not overflow the stack. */
+void EmbeddedRispHybrid::partition_neurons() {
+    std::vector<std::vector<unsigned int>> adj;
+    std::vector<int> index;
+    std::vector<int> lowlink;
+    std::vector<bool> on_stack;
+    std::vector<unsigned int> scc_stack;
+    std::vector<std::pair<unsigned int, unsigned int>> call_stack;
+    std::vector<unsigned int> component;
+    unsigned int num_neurons;
+    unsigned int i;
+    unsigned int j;
+    unsigned int v;
+    unsigned int w;
+    unsigned int k;
+    int next_index;
+    bool self_loop;
+
+    num_neurons = ir->num_neurons();
+    adj.resize(num_neurons);
+    for (i = 0; i < num_neurons; i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            adj[i].push_back(ir->neurons[i].synapses[j].to);
+        }
+    }
+
+    neuron_is_hot.assign(num_neurons, false);
+    index.assign(num_neurons, -1);
+    lowlink.assign(num_neurons, 0);
+    on_stack.assign(num_neurons, false);
+    next_index = 0;
+
+    for (i = 0; i < num_neurons; i++) {
+        if (index[i] != -1) {
+            continue;
+        }
+
+        call_stack.push_back(std::make_pair(i, 0));
+        while (!call_stack.empty()) {
+            v = call_stack.back().first;
+            k = call_stack.back().second;
+
+            if (k == 0) {
+                index[v] = next_index;
+                lowlink[v] = next_index;
+                next_index++;
+                scc_stack.push_back(v);
+                on_stack[v] = true;
+            }
+
+            if (k < adj[v].size()) {
+                call_stack.back().second++;
+                w = adj[v][k];
+                if (index[w] == -1) {
+                    call_stack.push_back(std::make_pair(w, 0));
+                } else if (on_stack[w] && index[w] < lowlink[v]) {
+                    lowlink[v] = index[w];
+                }
+                continue;
+            }
+
+            /* All successors visited; pop v and close its component */
+            call_stack.pop_back();
+            if (!call_stack.empty() &&
+                lowlink[v] < lowlink[call_stack.back().first]) {
+                lowlink[call_stack.back().first] = lowlink[v];
+            }
+
+            if (lowlink[v] == index[v]) {
+                component.clear();
+                do {
+                    w = scc_stack.back();
+                    scc_stack.pop_back();
+                    on_stack[w] = false;
+                    component.push_back(w);
+                } while (w != v);
+
+                self_loop = false;
+                for (j = 0; j < adj[v].size(); j++) {
+                    if (adj[v][j] == v) {
+                        self_loop = true;
+                    }
+                }
+
+                if (component.size() > 1 || self_loop) {
+                    for (j = 0; j < component.size(); j++) {
+                        neuron_is_hot[component[j]] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    neuron_ind_to_partition_ind.resize(num_neurons);
+    hot_ind_to_neuron_ind.clear();
+    cold_ind_to_neuron_ind.clear();
+    for (i = 0; i < num_neurons; i++) {
+        if (neuron_is_hot[i]) {
+            neuron_ind_to_partition_ind[i] = hot_ind_to_neuron_ind.size();
+            hot_ind_to_neuron_ind.push_back(i);
+        } else {
+            neuron_ind_to_partition_ind[i] = cold_ind_to_neuron_ind.size();
+            cold_ind_to_neuron_ind.push_back(i);
+        }
+    }
+}
+
+/* Every timestep visits every neuron of the hot partition, while cold
+ * neurons are only tested when an event reaches them */
+void EmbeddedRispHybrid::wcet_bounds(unsigned int &events,
+                                     unsigned int &checks,
+                                     unsigned int &fires,
+                                     unsigned int &synapses) {
+    std::vector<bool> live;
+    std::vector<bool> reached;
+    unsigned int i;
+
+    EmbeddedRispBase::wcet_bounds(events, checks, fires, synapses);
+
+    partition_neurons();
+    wcet_reach(live, reached);
+    checks = 0;
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (reached[i] || neuron_is_hot[i]) {
+            checks++;
+        }
+    }
+}
+
+std::string EmbeddedRispHybrid::gen_static_c(unsigned int max_num_timesteps) {
+    IndentString s;
+    IRNeuron *cur_neuron;
+    IRSynapse *cur_synapse;
+    std::vector<IRSynapse *> ordered_synapses;
+    std::vector<unsigned int> num_outgoing_hot;
+    unsigned int i;
+    unsigned int j;
+    unsigned int to_ind;
+    bool hot_has_leak;
+
+    if (fire_like_ravens) {
+        throw(std::string) "EmbeddedRispHybrid does not support the "
+                           "fire_like_ravens flag.";
+    }
+
+    partition_neurons();
+
+    s = "/*************** RISP HYBRID NETWORK CODE ********************/\n"
+        "\n" +
+        gen_defines_c(max_num_timesteps) + gen_event_capacity_c() +
+        "#define NUM_HOT_NEURONS (" +
+        std::to_string(hot_ind_to_neuron_ind.size()) +
+        ")\n"
+        "#define NUM_COLD_NEURONS (" +
+        std::to_string(cold_ind_to_neuron_ind.size()) +
+        ")\n"
+        "\n"
+        "/* Synapse struct */\n"
+        "typedef struct {\n"
+        "    unsigned int to;    /* Index of to neuron within its partition "
+        "*/\n"
+        "    unsigned int delay; /* Synapse delay value */\n"
+        "    weight_t weight;     /* Synapse weight value */\n"
+        "} Synapse;\n"
+        "\n";
+
+    if (!cold_ind_to_neuron_ind.empty()) {
+        s += "/* Cold (event-driven) neuron struct */\n"
+             "typedef struct {\n"
+             "    unsigned char leak;             /* Leak value (1 for full "
+             "leak and 0 for no leak) */\n"
+             "    unsigned char check;            /* Whether or not we have "
+             "checked if this neuron fires */\n"
+             "    unsigned int num_outgoing_hot;  /* Number of outgoing "
+             "synapses into the hot partition */\n"
+             "    unsigned int num_outgoing;      /* Number of outgoing "
+             "synapses for this neuron */\n"
+             "    charge_t charge;                /* Charge value */\n"
+             "    weight_t threshold;             /* Threshold value */\n"
+             "    Synapse outgoing[MAX_OUTGOING]; /* Outgoing synapses, hot "
+             "targets first */\n"
+             "} Cold_Neuron;\n"
+             "\n"
+             "/* Charge change event struct (essentially just a pair) */\n"
+             "typedef struct {\n"
+             "    unsigned int neuron_ind; /* Cold index of neuron to change "
+             "the charge for */\n"
+             "    charge_t charge_change;  /* Value to change charge by */\n"
+             "} Charge_Change_Event;\n"
+             "\n";
+    }
+
+    s += gen_io_tables_c();
+
+    s += "const unsigned char NEURON_IS_HOT[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < neuron_is_hot.size(); i++) {
+        s += neuron_is_hot[i] ? "1" : "0";
+        if (i != neuron_is_hot.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "const unsigned int NEURON_IND_TO_PARTITION_IND[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < neuron_ind_to_partition_ind.size(); i++) {
+        s += std::to_string(neuron_ind_to_partition_ind[i]);
+        if (i != neuron_ind_to_partition_ind.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n"
+         "\n"
+         "unsigned int neuron_fire_count[NUM_NEURONS] = {0};\n"
+         "int neuron_last_fire[NUM_NEURONS] = {0};\n"
+         "unsigned int cur_timestep_ind = 0; /* Ring buffer index of the "
+         "upcoming timestep, shared by both partitions */\n"
+         "\n";
+
+    // Outgoing synapses of every neuron are emitted with hot targets first so
+    // the generated fan-out loop can split on num_outgoing_hot
+    num_outgoing_hot.resize(ir->num_neurons());
+    for (i = 0; i < ir->num_neurons(); i++) {
+        cur_neuron = &ir->neurons[i];
+        num_outgoing_hot[i] = 0;
+        for (j = 0; j < cur_neuron->synapses.size(); j++) {
+            if (neuron_is_hot[cur_neuron->synapses[j].to]) {
+                num_outgoing_hot[i]++;
+            }
+        }
+    }
+
+    if (!hot_ind_to_neuron_ind.empty()) {
+        hot_has_leak = false;
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            if (ir->neurons[hot_ind_to_neuron_ind[i]].leak) {
+                hot_has_leak = true;
+            }
+        }
+
+        s += "/* Hot (dense) partition */\n"
+             "const unsigned int HOT_IND_TO_NEURON_IND[NUM_HOT_NEURONS] = {\n"
+             "    ";
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            s += std::to_string(hot_ind_to_neuron_ind[i]);
+            if (i != hot_ind_to_neuron_ind.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+
+        if (hot_has_leak) {
+            s += "unsigned char hot_leak[NUM_HOT_NEURONS] = {\n    ";
+            for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+                s += std::to_string(
+                    (unsigned char)ir->neurons[hot_ind_to_neuron_ind[i]].leak);
+                if (i != hot_ind_to_neuron_ind.size() - 1) {
+                    s += ", ";
+                }
+            }
+            s += "\n};\n";
+        }
+
+        s += "weight_t hot_threshold[NUM_HOT_NEURONS] = {\n    ";
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            s += real_c(ir->neurons[hot_ind_to_neuron_ind[i]].threshold);
+            if (i != hot_ind_to_neuron_ind.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+
+        s += "unsigned int hot_num_outgoing_hot[NUM_HOT_NEURONS] = {\n    ";
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            s += std::to_string(num_outgoing_hot[hot_ind_to_neuron_ind[i]]);
+            if (i != hot_ind_to_neuron_ind.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+
+        s += "unsigned int hot_num_outgoing[NUM_HOT_NEURONS] = {\n    ";
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            s += std::to_string(
+                ir->neurons[hot_ind_to_neuron_ind[i]].synapses.size());
+            if (i != hot_ind_to_neuron_ind.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+
+        s += "charge_t hot_charge[NUM_HOT_NEURONS] = {0};\n"
+             "charge_t hot_charge_buffer[MAX_NUM_TIMESTEPS][NUM_HOT_NEURONS] = "
+             "{0};\n"
+             "unsigned char hot_active[MAX_NUM_TIMESTEPS][NUM_HOT_NEURONS] = "
+             "{0};\n";
+
+        s += "Synapse hot_outgoing[NUM_HOT_NEURONS][MAX_OUTGOING] = {\n    ";
+        for (i = 0; i < hot_ind_to_neuron_ind.size(); i++) {
+            cur_neuron = &ir->neurons[hot_ind_to_neuron_ind[i]];
+
+            ordered_synapses.clear();
+            for (j = 0; j < cur_neuron->synapses.size(); j++) {
+                if (neuron_is_hot[cur_neuron->synapses[j].to]) {
+                    ordered_synapses.push_back(&cur_neuron->synapses[j]);
+                }
+            }
+            for (j = 0; j < cur_neuron->synapses.size(); j++) {
+                if (!neuron_is_hot[cur_neuron->synapses[j].to]) {
+                    ordered_synapses.push_back(&cur_neuron->synapses[j]);
+                }
+            }
+
+            s += "{";
+            for (j = 0; j < ordered_synapses.size(); j++) {
+                cur_synapse = ordered_synapses[j];
+                to_ind = neuron_ind_to_partition_ind[cur_synapse->to];
+                s += "{" + std::to_string(to_ind) + "," +
+                     std::to_string(cur_synapse->delay) + "," +
+                     real_c(cur_synapse->weight) + "}";
+                if (j != ordered_synapses.size() - 1) {
+                    s += ", ";
+                }
+            }
+            if (ordered_synapses.size() == 0) {
+                s += "{0}";
+            }
+            s += "}";
+            if (i != hot_ind_to_neuron_ind.size() - 1) {
+                s += ",\n    ";
+            }
+        }
+        s += "\n};\n"
+             "\n";
+    }
+
+    if (!cold_ind_to_neuron_ind.empty()) {
+        s += "/* Cold (event-driven) partition */\n"
+             "const unsigned int COLD_IND_TO_NEURON_IND[NUM_COLD_NEURONS] = {\n"
+             "    ";
+        for (i = 0; i < cold_ind_to_neuron_ind.size(); i++) {
+            s += std::to_string(cold_ind_to_neuron_ind[i]);
+            if (i != cold_ind_to_neuron_ind.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n"
+             "unsigned int event_count[MAX_NUM_TIMESTEPS] = {0};              "
+             "     /* Number of charge change events for each timestep */\n"
+             "Charge_Change_Event "
+             "charge_changes[MAX_NUM_TIMESTEPS][MAX_EVENTS_PER_TIMESTEP]; "
+             "/* Charge changes keyed on timestep and charge change event index "
+             "*/\n";
+
+        s += "Cold_Neuron cold_neurons[NUM_COLD_NEURONS] = { ";
+        for (i = 0; i < cold_ind_to_neuron_ind.size(); i++) {
+            cur_neuron = &ir->neurons[cold_ind_to_neuron_ind[i]];
+
+            ordered_synapses.clear();
+            for (j = 0; j < cur_neuron->synapses.size(); j++) {
+                if (neuron_is_hot[cur_neuron->synapses[j].to]) {
+                    ordered_synapses.push_back(&cur_neuron->synapses[j]);
+                }
+            }
+            for (j = 0; j < cur_neuron->synapses.size(); j++) {
+                if (!neuron_is_hot[cur_neuron->synapses[j].to]) {
+                    ordered_synapses.push_back(&cur_neuron->synapses[j]);
+                }
+            }
+
+            s += "{" + std::to_string((unsigned char)cur_neuron->leak) +
+                 ", 0, " +
+                 std::to_string(num_outgoing_hot[cold_ind_to_neuron_ind[i]]) +
+                 ", " + std::to_string(ordered_synapses.size()) + ", 0, " +
+                 real_c(cur_neuron->threshold) + ", {";
+
+            for (j = 0; j < ordered_synapses.size(); j++) {
+                cur_synapse = ordered_synapses[j];
+                to_ind = neuron_ind_to_partition_ind[cur_synapse->to];
+                s += "{" + std::to_string(to_ind) + "," +
+                     std::to_string(cur_synapse->delay) + "," +
+                     real_c(cur_synapse->weight) + "}";
+                if (j != ordered_synapses.size() - 1) {
+                    s += ", ";
+                }
+            }
+            if (ordered_synapses.size() == 0) {
+                s += "{0}";
+            }
+            s += "}}";
+
+            if (i != cold_ind_to_neuron_ind.size() - 1) {
+                s += ",\n                                          ";
+            }
+        }
+        s += " };\n"
+             "\n";
+    }
+
+    s += gen_apply_spike_c() + "\n";
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_c() + "\n";
+    }
+    if (output_callback) {
+        s += gen_output_callback_c() + "\n";
+    }
+    if (run_until) {
+        s += gen_run_until_defines_c() + "\n" + gen_network_quiescent_c() +
+             "\n";
+    }
+    s += gen_run_c() + "\n";
+    if (run_until) {
+        s += gen_run_until_wrapper_c() + "\n";
+    }
+    s += gen_clear_activity_c() + "\n";
+    s += gen_output_last_fire_c() + "\n";
+    s += gen_output_count_c();
+    if (tick) {
+        s += "\n" + gen_tick_c();
+    }
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispHybrid::gen_apply_spike_c() {
+    IndentString s;
+
+    s = "/* This function will apply a spike of potential value value to the "
+        "input neuron with an input neuron zero-based index of input_ind at "
+        "time time relative to the current timestep of the neuroprocessor. */\n"
+        "void apply_spike(unsigned int input_ind, unsigned int time, double "
+        "value) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int target_timestep_ind;\n"
+         "unsigned int neuron_ind;\n"
+         "\n"
+         "/* Ensure input neuron index is not out of bounds */\n"
+         "if (input_ind >= NUM_INPUT_NEURONS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "/* Ensure time is not out of bounds */\n"
+         "if (time >= MAX_NUM_TIMESTEPS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "target_timestep_ind = (cur_timestep_ind + time) % "
+         "MAX_NUM_TIMESTEPS;\n"
+         "neuron_ind = INPUT_IND_TO_NEURON_IND[input_ind];\n"
+         "\n";
+
+    if (hot_ind_to_neuron_ind.empty()) {
+        s += "/* Schedule charge change for the (cold) input neuron */\n"
+             "if (event_count[target_timestep_ind] < "
+             "MAX_EVENTS_PER_TIMESTEP) {\n"
+             "    charge_changes[target_timestep_ind][event_count[target_"
+             "timestep_ind]].neuron_ind = "
+             "NEURON_IND_TO_PARTITION_IND[neuron_ind];\n"
+             "    charge_changes[target_timestep_ind][event_count[target_"
+             "timestep_ind]].charge_change = SPIKE_CHARGE(value);\n"
+             "    event_count[target_timestep_ind]++;\n"
+             "} else {\n"
+             "    SNN_STATS_ADD(dropped_events, 1);\n"
+             "}\n";
+    } else if (cold_ind_to_neuron_ind.empty()) {
+        s += "/* Accumulate charge for the (hot) input neuron */\n"
+             "hot_charge_buffer[target_timestep_ind][NEURON_IND_TO_PARTITION_"
+             "IND[neuron_ind]] += SPIKE_CHARGE(value);\n"
+             "hot_active[target_timestep_ind][NEURON_IND_TO_PARTITION_IND["
+             "neuron_ind]] = 1;\n";
+    } else {
+        s += "if (NEURON_IS_HOT[neuron_ind]) {\n"
+             "    /* Accumulate charge in the dense buffer */\n"
+             "    hot_charge_buffer[target_timestep_ind][NEURON_IND_TO_"
+             "PARTITION_IND[neuron_ind]] += SPIKE_CHARGE(value);\n"
+             "    hot_active[target_timestep_ind][NEURON_IND_TO_PARTITION_IND["
+             "neuron_ind]] = 1;\n"
+             "} else if (event_count[target_timestep_ind] < "
+             "MAX_EVENTS_PER_TIMESTEP) {\n"
+             "    /* Schedule charge change in the event queue */\n"
+             "    charge_changes[target_timestep_ind][event_count[target_"
+             "timestep_ind]].neuron_ind = "
+             "NEURON_IND_TO_PARTITION_IND[neuron_ind];\n"
+             "    charge_changes[target_timestep_ind][event_count[target_"
+             "timestep_ind]].charge_change = SPIKE_CHARGE(value);\n"
+             "    event_count[target_timestep_ind]++;\n"
+             "} else {\n"
+             "    SNN_STATS_ADD(dropped_events, 1);\n"
+             "}\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispHybrid::gen_run_c() {
+    IndentString s;
+    std::string cmp;
+    unsigned int i;
+    bool hot_has_leak;
+    bool cold_has_leak;
+    bool has_hot;
+    bool has_cold;
+
+    has_hot = !hot_ind_to_neuron_ind.empty();
+    has_cold = !cold_ind_to_neuron_ind.empty();
+
+    hot_has_leak = false;
+    cold_has_leak = false;
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (ir->neurons[i].leak) {
+            if (neuron_is_hot[i]) {
+                hot_has_leak = true;
+            } else {
+                cold_has_leak = true;
+            }
+        }
+    }
+
+    cmp = threshold_inclusive ? ">=" : ">";
+
+    s = gen_run_header_c();
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int time;\n"
+         "unsigned int i;\n"
+         "unsigned int j;\n"
+         "unsigned int run_time;\n"
+         "unsigned int cur_neuron_ind;\n"
+         "unsigned int to_time;\n"
+         "const Synapse *syn;\n"
+         "\n"
+         "/* Clear tracking info on all neurons */\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n"
+         "    neuron_last_fire[i] = -1;\n"
+         "    neuron_fire_count[i] = 0;\n"
+         "}\n"
+         "\n";
+
+    s += gen_run_time_c();
+
+    s += "\n"
+         "for (time = 0; time <= run_time; time++) {\n"
+         "\n";
+
+    s.add_indent_spaces(4);
+
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_drain_c() + "\n";
+    }
+
+    if (has_hot) {
+        s += "/* Hot partition: visit every neuron and fire those whose "
+             "buffered charge meets threshold */\n"
+             "for (i = 0; i < NUM_HOT_NEURONS; i++) {\n";
+        s.add_indent_spaces(4);
+
+        s += "if (!hot_active[cur_timestep_ind][i]) {\n"
+             "    continue;\n"
+             "}\n"
+             "SNN_STATS_ADD(events, 1);\n"
+             "\n";
+
+        if (hot_has_leak) {
+            s += "if (hot_leak[i]) {\n"
+                 "    hot_charge[i] = 0;\n"
+                 "}\n";
+        }
+
+        s += "if (hot_charge[i] < MIN_POTENTIAL) {\n"
+             "    hot_charge[i] = MIN_POTENTIAL;\n"
+             "}\n"
+             "hot_charge[i] += hot_charge_buffer[cur_timestep_ind][i];\n"
+             "hot_charge_buffer[cur_timestep_ind][i] = 0;\n"
+             "hot_active[cur_timestep_ind][i] = 0;\n"
+             "\n"
+             "if (hot_charge[i] " + cmp + " hot_threshold[i]) {\n";
+        s.add_indent_spaces(4);
+
+        s += "for (j = 0; j < hot_num_outgoing_hot[i]; j++) {\n"
+             "    syn = &hot_outgoing[i][j];\n"
+             "    to_time = (cur_timestep_ind + syn->delay) % "
+             "MAX_NUM_TIMESTEPS;\n"
+             "    hot_charge_buffer[to_time][syn->to] += syn->weight;\n"
+             "    hot_active[to_time][syn->to] = 1;\n"
+             "}\n";
+
+        if (has_cold) {
+            s += "for (; j < hot_num_outgoing[i]; j++) {\n"
+                 "    syn = &hot_outgoing[i][j];\n"
+                 "    to_time = (cur_timestep_ind + syn->delay) % "
+                 "MAX_NUM_TIMESTEPS;\n"
+                 "    if (event_count[to_time] < MAX_EVENTS_PER_TIMESTEP) {\n"
+                 "        charge_changes[to_time][event_count[to_time]]."
+                 "neuron_ind = syn->to;\n"
+                 "        charge_changes[to_time][event_count[to_time]]."
+                 "charge_change = syn->weight;\n"
+                 "        event_count[to_time]++;\n"
+                 "    } else {\n"
+                 "        SNN_STATS_ADD(dropped_events, 1);\n"
+                 "    }\n"
+                 "}\n";
+        }
+
+        s += "SNN_STATS_ADD(fires, 1);\n"
+             "SNN_STATS_ADD(synapses, j);\n"
+             "\n"
+             "cur_neuron_ind = HOT_IND_TO_NEURON_IND[i];\n"
+             "neuron_last_fire[cur_neuron_ind] = time;\n"
+             "neuron_fire_count[cur_neuron_ind]++;\n"
+             "hot_charge[i] = 0;\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "\n";
+    }
+
+    if (has_cold) {
+        if (cold_has_leak) {
+            s += "/* Cold partition: apply leak and reset minimum charge for "
+                 "neurons with events */\n";
+        } else {
+            s += "/* Cold partition: reset minimum charge for neurons with "
+                 "events */\n";
+        }
+
+        s += "SNN_STATS_ADD(events, event_count[cur_timestep_ind]);\n"
+             "SNN_STATS_MAX(peak_events, event_count[cur_timestep_ind]);\n"
+             "for (i = 0; i < event_count[cur_timestep_ind]; i++) {\n";
+        s.add_indent_spaces(4);
+
+        s += "cur_neuron_ind = charge_changes[cur_timestep_ind][i].neuron_ind;\n";
+
+        if (cold_has_leak) {
+            s += "if (cold_neurons[cur_neuron_ind].leak) {\n"
+                 "    cold_neurons[cur_neuron_ind].charge = 0;\n"
+                 "}\n";
+        }
+
+        s += "if (cold_neurons[cur_neuron_ind].charge < MIN_POTENTIAL) {\n"
+             "    cold_neurons[cur_neuron_ind].charge = MIN_POTENTIAL;\n"
+             "}\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "\n"
+             "/* Collect charges */\n"
+             "for (i = 0; i < event_count[cur_timestep_ind]; i++) {\n"
+             "    cur_neuron_ind = "
+             "charge_changes[cur_timestep_ind][i].neuron_ind;\n"
+             "    cold_neurons[cur_neuron_ind].check = 1;\n"
+             "    cold_neurons[cur_neuron_ind].charge += "
+             "charge_changes[cur_timestep_ind][i].charge_change;\n"
+             "}\n"
+             "\n"
+             "/* Determine if neuron fires */\n"
+             "for (i = 0; i < event_count[cur_timestep_ind]; i++) {\n";
+        s.add_indent_spaces(4);
+
+        s += "cur_neuron_ind = charge_changes[cur_timestep_ind][i].neuron_ind;\n"
+             "\n"
+             "if (cold_neurons[cur_neuron_ind].check == 1) {\n";
+        s.add_indent_spaces(4);
+
+        s += "if (cold_neurons[cur_neuron_ind].charge " + cmp +
+             " cold_neurons[cur_neuron_ind].threshold) {\n";
+        s.add_indent_spaces(4);
+
+        if (has_hot) {
+            s += "for (j = 0; j < cold_neurons[cur_neuron_ind].num_outgoing_hot; "
+                 "j++) {\n"
+                 "    syn = &cold_neurons[cur_neuron_ind].outgoing[j];\n"
+                 "    to_time = (cur_timestep_ind + syn->delay) % "
+                 "MAX_NUM_TIMESTEPS;\n"
+                 "    hot_charge_buffer[to_time][syn->to] += syn->weight;\n"
+                 "    hot_active[to_time][syn->to] = 1;\n"
+                 "}\n"
+                 "for (; j < cold_neurons[cur_neuron_ind].num_outgoing; j++) {\n";
+        } else {
+            s += "for (j = 0; j < cold_neurons[cur_neuron_ind].num_outgoing; "
+                 "j++) {\n";
+        }
+
+        s += "    syn = &cold_neurons[cur_neuron_ind].outgoing[j];\n"
+             "    to_time = (cur_timestep_ind + syn->delay) % "
+             "MAX_NUM_TIMESTEPS;\n"
+             "    if (event_count[to_time] < MAX_EVENTS_PER_TIMESTEP) {\n"
+             "        charge_changes[to_time][event_count[to_time]].neuron_ind "
+             "= syn->to;\n"
+             "        charge_changes[to_time][event_count[to_time]]."
+             "charge_change = syn->weight;\n"
+             "        event_count[to_time]++;\n"
+             "    } else {\n"
+             "        SNN_STATS_ADD(dropped_events, 1);\n"
+             "    }\n"
+             "}\n"
+             "SNN_STATS_ADD(fires, 1);\n"
+             "SNN_STATS_ADD(synapses, j);\n"
+             "\n"
+             "neuron_last_fire[COLD_IND_TO_NEURON_IND[cur_neuron_ind]] = time;\n"
+             "neuron_fire_count[COLD_IND_TO_NEURON_IND[cur_neuron_ind]]++;\n"
+             "cold_neurons[cur_neuron_ind].charge = 0;\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "\n"
+             "cold_neurons[cur_neuron_ind].check = 0;\n";
+        s.add_indent_spaces(-4);
+        s += "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "event_count[cur_timestep_ind] = 0;\n"
+             "\n";
+    }
+
+    if (output_callback) {
+        s += gen_output_callback_call_c(
+                 "neuron_last_fire[OUTPUT_IND_TO_NEURON_IND[i]]") + "\n";
+    }
+
+    s += "/* \"Shift\" (using ring buffer) to progress to the next timestep */\n"
+         "cur_timestep_ind = (cur_timestep_ind + 1) % MAX_NUM_TIMESTEPS;\n"
+         "SNN_STATS_ADD(timesteps, 1);\n";
+
+    if (run_until) {
+        s += "\n" +
+             gen_run_until_check_c(
+                 "neuron_last_fire[OUTPUT_IND_TO_NEURON_IND[i]]",
+                 "neuron_fire_count[OUTPUT_IND_TO_NEURON_IND[i]]");
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n"
+         "\n";
+
+    if (hot_has_leak || cold_has_leak) {
+        s += "/* Apply leak and reset minimum charge before the next run */\n";
+    } else {
+        s += "/* Reset minimum charge before the next run */\n";
+    }
+
+    if (has_hot) {
+        s += "for (i = 0; i < NUM_HOT_NEURONS; i++) {\n";
+        s.add_indent_spaces(4);
+        if (hot_has_leak) {
+            s += "if (hot_leak[i]) {\n"
+                 "    hot_charge[i] = 0;\n"
+                 "}\n";
+        }
+        s += "if (hot_charge[i] < MIN_POTENTIAL) {\n"
+             "    hot_charge[i] = MIN_POTENTIAL;\n"
+             "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n";
+    }
+
+    if (has_cold) {
+        s += "for (i = 0; i < NUM_COLD_NEURONS; i++) {\n";
+        s.add_indent_spaces(4);
+        if (cold_has_leak) {
+            s += "if (cold_neurons[i].leak) {\n"
+                 "    cold_neurons[i].charge = 0;\n"
+                 "}\n";
+        }
+        s += "if (cold_neurons[i].charge < MIN_POTENTIAL) {\n"
+             "    cold_neurons[i].charge = MIN_POTENTIAL;\n"
+             "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n";
+    }
+
+    if (run_until) {
+        s += "\n"
+             "return time;\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* Spikes in flight are the pending rows of the hot partition's dense
+ * buffer and the cold partition's charge change events */
+std::string EmbeddedRispHybrid::gen_network_quiescent_c() {
+    IndentString s;
+
+    s = "/* This function will return 1 if no spikes are in flight in the SNN "
+        "and 0 otherwise. */\n"
+        "int network_quiescent(void) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n";
+    if (!hot_ind_to_neuron_ind.empty()) {
+        s += "unsigned int j;\n";
+    }
+    s += "\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n";
+
+    s.add_indent_spaces(4);
+
+    if (!hot_ind_to_neuron_ind.empty()) {
+        s += "for (j = 0; j < NUM_HOT_NEURONS; j++) {\n"
+             "    if (hot_active[i][j]) {\n"
+             "        return 0;\n"
+             "    }\n"
+             "}\n";
+    }
+    if (!cold_ind_to_neuron_ind.empty()) {
+        s += "if (event_count[i] != 0) {\n"
+             "    return 0;\n"
+             "}\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n"
+         "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispHybrid::gen_clear_activity_c() {
+    IndentString s;
+
+    s = "/* This function will clear the SNN of all activity. It resets all "
+        "neuron and synapse state. */\n"
+        "void clear_activity() {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "\n"
+         "/* Clear activity-related neuron state */\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n"
+         "    neuron_last_fire[i] = -1;\n"
+         "    neuron_fire_count[i] = 0;\n"
+         "}\n";
+
+    if (!hot_ind_to_neuron_ind.empty()) {
+        s += "for (i = 0; i < NUM_HOT_NEURONS; i++) {\n"
+             "    hot_charge[i] = 0;\n"
+             "}\n";
+    }
+    if (!cold_ind_to_neuron_ind.empty()) {
+        s += "for (i = 0; i < NUM_COLD_NEURONS; i++) {\n"
+             "    cold_neurons[i].charge = 0;\n"
+             "}\n";
+    }
+
+    s += "\n"
+         "/* Clear all event activity */\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n";
+    s.add_indent_spaces(4);
+    if (!hot_ind_to_neuron_ind.empty()) {
+        s += "for (j = 0; j < NUM_HOT_NEURONS; j++) {\n"
+             "    hot_charge_buffer[i][j] = 0;\n"
+             "    hot_active[i][j] = 0;\n"
+             "}\n";
+    }
+    if (!cold_ind_to_neuron_ind.empty()) {
+        s += "event_count[i] = 0;\n";
+    }
+    s.add_indent_spaces(-4);
+    s += "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispHybrid::gen_output_last_fire_c() {
+    IndentString s;
+
+    s = "/* This function will return the timestep of the output neuron with "
+        "an output neuron zero-based index of output_ind. The returned "
+        "timestep will only be for the most recent call of the run() function. "
+        "*/\n"
+        "double output_last_fire(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return -1;\n"
+         "}\n"
+         "\n"
+         "return (double)neuron_last_fire[OUTPUT_IND_TO_NEURON_IND[output_ind]];"
+         "\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispHybrid::gen_output_count_c() {
+    IndentString s;
+
+    s = "/* This function will return the number of neuronal fires for the "
+        "output neuron with an output neuron zero-based index of output_ind. "
+        "The returned fire count will only be for the most recent call of the "
+        "run() function. */\n"
+        "unsigned int output_count(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return 0;\n"
+         "}\n"
+         "\n"
+         "return neuron_fire_count[OUTPUT_IND_TO_NEURON_IND[output_ind]];\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
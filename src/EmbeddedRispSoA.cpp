@@ -1,151 +1,37 @@
 #include "EmbeddedRispSoA.hpp"
 #include "helpers.hpp"
-#include <unordered_map>
-
-EmbeddedRispSoA::EmbeddedRispSoANetwork::EmbeddedRispSoANetwork(
-    neuro::Network *net, double _spike_value_factor, double _min_potential,
-    char leak, bool _run_time_inclusive, bool _threshold_inclusive,
-    bool _fire_like_ravens, bool _discrete, bool _inputs_from_weights,
-    uint32_t _noisy_seed, double _noisy_stddev, vector<double> &_weights,
-    vector<double> &_stds)
-    : risp::Network(net, _spike_value_factor, _min_potential, leak,
-                    _run_time_inclusive, _threshold_inclusive,
-                    _fire_like_ravens, _discrete, _inputs_from_weights,
-                    _noisy_seed, _noisy_stddev, _weights, _stds) {
-    sorted_neuron_vector_public = sorted_neuron_vector;
-}
+#include <algorithm>
+#include <map>
 
 EmbeddedRispSoA::EmbeddedRispSoA(neuro::json &params)
-    : risp::Processor(params) {
-    rnet = nullptr;
-    enet = nullptr;
-}
-
-EmbeddedRispSoA::~EmbeddedRispSoA() {
-    if (enet != nullptr) {
-        delete enet;
-    }
+    : EmbeddedRispBase(params) {
+    spmv_propagation = false;
 }
 
-bool EmbeddedRispSoA::load_network(neuro::Network *net, int network_id) {
-    bool res;
-
-    res = risp::Processor::load_network(net, network_id);
-
-    rnet = net;
-    enet = new EmbeddedRispSoANetwork(
-        net, spike_value_factor, min_potential, leak_mode[0],
-        run_time_inclusive, threshold_inclusive, fire_like_ravens, discrete,
-        inputs_from_weights, noisy_seed, noisy_stddev, weights, stds);
-
-    return res;
-}
+EmbeddedRispSoA::~EmbeddedRispSoA() {}
 
 std::string EmbeddedRispSoA::gen_static_c(unsigned int max_num_timesteps) {
     IndentString s;
-    risp::Neuron *cur_neuron;
-    neuro::Node *cur_node;
-    std::unordered_map<uint32_t, unsigned int> neuron_id_to_ind;
-    std::vector<unsigned int> input_ind_to_neuron_ind;
-    std::vector<unsigned int> output_ind_to_neuron_ind;
     unsigned int i;
-    unsigned int j;
-    unsigned int max_outgoing;
-
-    max_outgoing = 0;
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        cur_neuron = enet->sorted_neuron_vector_public[i];
-
-        if (cur_neuron->synapses.size() > max_outgoing) {
-            max_outgoing = cur_neuron->synapses.size();
-        }
-
-        neuron_id_to_ind[cur_neuron->id] = i;
-    }
 
-    rnet->make_sorted_node_vector();
-    input_ind_to_neuron_ind.resize(rnet->num_inputs());
-    output_ind_to_neuron_ind.resize(rnet->num_outputs());
-    for (i = 0; i < rnet->sorted_node_vector.size(); i++) {
-        cur_node = rnet->sorted_node_vector[i];
-        if (cur_node->is_input()) {
-            input_ind_to_neuron_ind[cur_node->input_id] = i;
-        }
-        if (cur_node->is_output()) {
-            output_ind_to_neuron_ind[cur_node->output_id] = i;
-        }
-    }
-
-    s = "#define NUM_NEURONS (" + std::to_string(rnet->num_nodes()) +
-        ")\n"
-        "#define NUM_INPUT_NEURONS (" +
-        std::to_string(rnet->num_inputs()) +
-        ")\n"
-        "#define NUM_OUTPUT_NEURONS (" +
-        std::to_string(rnet->num_outputs()) +
-        ")\n"
-        "#define NUM_SYNAPSES (" +
-        std::to_string(rnet->num_edges()) +
-        ")\n"
-        "#define MAX_NUM_TIMESTEPS (" +
-        std::to_string(max_num_timesteps) +
-        ")\n"
-        "#define MAX_OUTGOING (" +
-        std::to_string(max_outgoing) +
-        ")\n"
-        "#define MIN_POTENTIAL (" +
-        std::to_string(min_potential) +
-        ")\n"
-        "#define SPIKE_VALUE_FACTOR (" +
-        std::to_string(spike_value_factor) +
-        ")\n"
+    s = gen_defines_c(max_num_timesteps) +
         "\n"
         "unsigned long current_timestep = 0;\n"
-        "\n"
-        "const unsigned int INPUT_IND_TO_NEURON_IND[NUM_INPUT_NEURONS] = {";
-
-    for (i = 0; i < input_ind_to_neuron_ind.size(); i++) {
-        s += std::to_string(input_ind_to_neuron_ind[i]);
-        if (i != input_ind_to_neuron_ind.size() - 1) {
-            s += ", ";
-        }
-    }
-
-    s += "};\nconst unsigned int OUTPUT_IND_TO_NEURON_IND[NUM_OUTPUT_NEURONS] "
-         "= {";
+        "\n";
 
-    for (i = 0; i < output_ind_to_neuron_ind.size(); i++) {
-        s += std::to_string(output_ind_to_neuron_ind[i]);
-        if (i != output_ind_to_neuron_ind.size() - 1) {
-            s += ", ";
-        }
-    }
+    s += gen_io_tables_c();
 
-    s += "};\n"
-         "\n";
+    s += "\n";
 
     if (fire_like_ravens) {
-        fprintf(
-            stderr,
-            "EmbeddedRispSoA does not support the fire_like_ravens flag.\n");
-        exit(1);
+        throw(std::string) "EmbeddedRispSoA does not support the "
+                           "fire_like_ravens flag.";
     }
 
     s += "unsigned char neuron_leak[NUM_NEURONS] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        s += std::to_string(
-            (unsigned char)enet->sorted_neuron_vector_public[i]->leak);
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
-            s += ", ";
-        }
-    }
-    s += "\n};\n";
-
-    s += "unsigned int neuron_outgoing[NUM_NEURONS] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        s += std::to_string((unsigned int)enet->sorted_neuron_vector_public[i]
-                                ->synapses.size());
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
+    for (i = 0; i < ir->neurons.size(); i++) {
+        s += std::to_string((unsigned char)ir->neurons[i].leak);
+        if (i != ir->neurons.size() - 1) {
             s += ", ";
         }
     }
@@ -158,14 +44,14 @@ std::string EmbeddedRispSoA::gen_static_c(unsigned int max_num_timesteps) {
     s += "unsigned int neuron_fire_times[NUM_NEURONS][MAX_NUM_TIMESTEPS] = "
          "{0};\n";
 
-    s += "double neuron_charge_buffer[MAX_NUM_TIMESTEPS][NUM_NEURONS] = {0};\n";
+    s += "charge_t neuron_charge_buffer[MAX_NUM_TIMESTEPS][NUM_NEURONS] = "
+         "{0};\n";
     s += "unsigned char neuron_active[MAX_NUM_TIMESTEPS][NUM_NEURONS] = {0};\n";
 
-    s += "double neuron_threshold[NUM_NEURONS] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        s += std::to_string(
-            (double)enet->sorted_neuron_vector_public[i]->threshold);
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
+    s += "weight_t neuron_threshold[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        s += real_c(ir->neurons[i].threshold);
+        if (i != ir->neurons.size() - 1) {
             s += ", ";
         }
     }
@@ -173,84 +59,284 @@ std::string EmbeddedRispSoA::gen_static_c(unsigned int max_num_timesteps) {
 
     s += "\n";
 
+    if (spmv_propagation) {
+        s += gen_spmv_tables_c();
+    } else {
+        s += gen_scatter_tables_c();
+    }
+
+    s += "\n";
+
+    s += gen_apply_spike_c() + "\n";
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_c() + "\n";
+    }
+    if (output_callback) {
+        s += gen_output_callback_c() + "\n";
+    }
+    if (run_until) {
+        s += gen_run_until_defines_c() + "\n" + gen_network_quiescent_c() +
+             "\n";
+    }
+    s += gen_run_c() + "\n";
+    if (run_until) {
+        s += gen_run_until_wrapper_c() + "\n";
+    }
+    s += gen_clear_activity_c() + "\n";
+    s += gen_output_last_fire_c() + "\n";
+    s += gen_output_count_c();
+    if (tick) {
+        s += "\n" + gen_tick_c();
+    }
+
+    return s.get_str();
+}
+
+/* Per-neuron outgoing synapse tables that the scatter propagation walks when
+ * a neuron fires */
+std::string EmbeddedRispSoA::gen_scatter_tables_c() {
+    IndentString s;
+    IRNeuron *node;
+    std::vector<std::pair<unsigned int, unsigned int>> runs;
+    unsigned int i;
+    unsigned int j;
+
+    s = "#define MAX_DELAY_RUNS (" +
+        std::to_string(std::max(ir->max_delay_runs(), 1u)) + ")\n\n";
+
+    s += "unsigned int neuron_num_runs[NUM_NEURONS] = {\n    ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        s += std::to_string((unsigned int)ir->delay_runs(i).size());
+        if (i != ir->neurons.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
     s += "unsigned int synapse_to[NUM_NEURONS][MAX_OUTGOING] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        risp::Neuron *node = enet->sorted_neuron_vector_public[i];
+    for (i = 0; i < ir->neurons.size(); i++) {
+        node = &ir->neurons[i];
 
         s += "{";
         if (node->synapses.size() == 0) {
             s += "0";
         } else {
             for (j = 0; j < node->synapses.size(); j++) {
-                s +=
-                    std::to_string(neuron_id_to_ind[node->synapses[j]->to->id]);
+                s += std::to_string(node->synapses[j].to);
                 if (j != node->synapses.size() - 1) {
                     s += ", ";
                 }
             }
         }
         s += "}";
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
+        if (i != ir->neurons.size() - 1) {
             s += ", ";
         }
     }
     s += "\n};\n";
 
-    s += "unsigned int synapse_delay[NUM_NEURONS][MAX_OUTGOING] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        risp::Neuron *node = enet->sorted_neuron_vector_public[i];
+    s += "weight_t synapse_weight[NUM_NEURONS][MAX_OUTGOING] = {\n    ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        node = &ir->neurons[i];
 
         s += "{";
         if (node->synapses.size() == 0) {
             s += "0";
         } else {
             for (j = 0; j < node->synapses.size(); j++) {
-                s += std::to_string(node->synapses[j]->delay);
+                s += real_c(node->synapses[j].weight);
                 if (j != node->synapses.size() - 1) {
                     s += ", ";
                 }
             }
         }
         s += "}";
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
+        if (i != ir->neurons.size() - 1) {
             s += ", ";
         }
     }
     s += "\n};\n";
 
-    s += "double synapse_weight[NUM_NEURONS][MAX_OUTGOING] = {\n    ";
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        risp::Neuron *node = enet->sorted_neuron_vector_public[i];
+    /* Synapses come in runs that share a delay; run_end holds one past the
+     * index of each run's last synapse */
+    s += "unsigned int run_delay[NUM_NEURONS][MAX_DELAY_RUNS] = {\n    ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        runs = ir->delay_runs(i);
 
         s += "{";
-        if (node->synapses.size() == 0) {
+        if (runs.size() == 0) {
             s += "0";
         } else {
-            for (j = 0; j < node->synapses.size(); j++) {
-                s += std::to_string((double)node->synapses[j]->weight);
-                if (j != node->synapses.size() - 1) {
+            for (j = 0; j < runs.size(); j++) {
+                s += std::to_string(runs[j].first);
+                if (j != runs.size() - 1) {
                     s += ", ";
                 }
             }
         }
         s += "}";
-        if (i != enet->sorted_neuron_vector_public.size() - 1) {
+        if (i != ir->neurons.size() - 1) {
             s += ", ";
         }
     }
     s += "\n};\n";
 
-    s += "\n";
+    s += "unsigned int run_end[NUM_NEURONS][MAX_DELAY_RUNS] = {\n    ";
+    for (i = 0; i < ir->neurons.size(); i++) {
+        runs = ir->delay_runs(i);
 
-    s += gen_apply_spike_c() + "\n";
-    s += gen_run_c() + "\n";
-    s += gen_clear_activity_c() + "\n";
-    s += gen_output_last_fire_c() + "\n";
-    s += gen_output_count_c();
+        s += "{";
+        if (runs.size() == 0) {
+            s += "0";
+        } else {
+            for (j = 0; j < runs.size(); j++) {
+                s += std::to_string(runs[j].second);
+                if (j != runs.size() - 1) {
+                    s += ", ";
+                }
+            }
+        }
+        s += "}";
+        if (i != ir->neurons.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
 
     return s.get_str();
 }
 
+/* One weight matrix per distinct synapse delay, each stored as compressed
+ * sparse rows keyed on the target neuron. Rows without synapses are left out,
+ * so spmv_row_to names the target of each stored row; spmv_delay_rows and
+ * spmv_row_start hold the first row of each matrix and the first entry of
+ * each row, with one extra element at the end. */
+std::string EmbeddedRispSoA::gen_spmv_tables_c() {
+    /* (source, weight) entries of each row, rows of each delay */
+    typedef std::map<unsigned int,
+                     std::vector<std::pair<unsigned int, double>>>
+        Matrix;
+    std::map<unsigned int, Matrix> mats;
+    std::map<unsigned int, Matrix>::iterator dit;
+    Matrix::iterator rit;
+    std::vector<unsigned int> delays;
+    std::vector<unsigned int> delay_rows;
+    std::vector<unsigned int> row_to;
+    std::vector<unsigned int> row_start;
+    std::vector<unsigned int> col;
+    std::vector<double> weight;
+    const IRSynapse *syn;
+    IndentString s;
+    unsigned int i;
+    unsigned int j;
+
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            syn = &ir->neurons[i].synapses[j];
+            mats[syn->delay][syn->to].push_back(
+                std::make_pair(i, syn->weight));
+        }
+    }
+
+    for (dit = mats.begin(); dit != mats.end(); dit++) {
+        delays.push_back(dit->first);
+        delay_rows.push_back(row_to.size());
+        for (rit = dit->second.begin(); rit != dit->second.end(); rit++) {
+            row_to.push_back(rit->first);
+            row_start.push_back(col.size());
+            for (j = 0; j < rit->second.size(); j++) {
+                col.push_back(rit->second[j].first);
+                weight.push_back(rit->second[j].second);
+            }
+        }
+    }
+    delay_rows.push_back(row_to.size());
+    row_start.push_back(col.size());
+
+    /* Keep every array at least one element long */
+    if (delays.empty()) {
+        delays.push_back(1);
+        delay_rows.push_back(0);
+    }
+    if (row_to.empty()) {
+        row_to.push_back(0);
+        row_start.push_back(0);
+    }
+    if (col.empty()) {
+        col.push_back(0);
+        weight.push_back(0);
+    }
+
+    s = "#define NUM_SPMV_DELAYS (" + std::to_string(delays.size()) +
+        ")\n"
+        "#define NUM_SPMV_ROWS (" +
+        std::to_string(row_to.size()) +
+        ")\n"
+        "#define NUM_SPMV_ENTRIES (" +
+        std::to_string(col.size()) +
+        ")\n"
+        "\n";
+
+    s += "unsigned int spmv_delay[NUM_SPMV_DELAYS] = {\n    ";
+    for (i = 0; i < delays.size(); i++) {
+        s += std::to_string(delays[i]);
+        if (i != delays.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "unsigned int spmv_delay_rows[NUM_SPMV_DELAYS + 1] = {\n    ";
+    for (i = 0; i < delay_rows.size(); i++) {
+        s += std::to_string(delay_rows[i]);
+        if (i != delay_rows.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "unsigned int spmv_row_to[NUM_SPMV_ROWS] = {\n    ";
+    for (i = 0; i < row_to.size(); i++) {
+        s += std::to_string(row_to[i]);
+        if (i != row_to.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "unsigned int spmv_row_start[NUM_SPMV_ROWS + 1] = {\n    ";
+    for (i = 0; i < row_start.size(); i++) {
+        s += std::to_string(row_start[i]);
+        if (i != row_start.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "unsigned int spmv_col[NUM_SPMV_ENTRIES] = {\n    ";
+    for (i = 0; i < col.size(); i++) {
+        s += std::to_string(col[i]);
+        if (i != col.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "weight_t spmv_weight[NUM_SPMV_ENTRIES] = {\n    ";
+    for (i = 0; i < weight.size(); i++) {
+        s += real_c(weight[i]);
+        if (i != weight.size() - 1) {
+            s += ", ";
+        }
+    }
+    s += "\n};\n";
+
+    s += "\n"
+         "/* 1 for every neuron that fired in the current timestep, else 0 */\n"
+         "unsigned char neuron_fired[NUM_NEURONS] = {0};\n";
+
+    return s.get_str();
+}
 std::string EmbeddedRispSoA::gen_apply_spike_c() {
     IndentString s;
 
@@ -275,7 +361,8 @@ std::string EmbeddedRispSoA::gen_apply_spike_c() {
          "MAX_NUM_TIMESTEPS;\n"
          "\n"
          "neuron_charge_buffer[target_timestep][INPUT_IND_TO_NEURON_IND[input_"
-         "ind]] += value * SPIKE_VALUE_FACTOR;\n"
+         "ind]] += SPIKE_CHARGE(value);\n"
+         "SNN_STATS_ADD(events, 1);\n"
          "neuron_active[target_timestep][INPUT_IND_TO_NEURON_IND[input_"
          "ind]] = 1;\n";
 
@@ -286,20 +373,26 @@ std::string EmbeddedRispSoA::gen_apply_spike_c() {
     return s.get_str();
 }
 
+/* Every timestep tests every neuron for a fire, and spmv propagation walks
+ * the whole connectivity matrix whenever any neuron fires */
+void EmbeddedRispSoA::wcet_bounds(unsigned int &events, unsigned int &checks,
+                                  unsigned int &fires,
+                                  unsigned int &synapses) {
+    EmbeddedRispBase::wcet_bounds(events, checks, fires, synapses);
+
+    checks = ir->num_neurons();
+    if (spmv_propagation && fires > 0) {
+        synapses = ir->num_synapses();
+    }
+}
+
 std::string EmbeddedRispSoA::gen_run_c() {
     IndentString s;
-    unsigned int i;
     bool net_all_leak;
 
-    net_all_leak = true;
-    for (i = 0; i < enet->sorted_neuron_vector_public.size(); i++) {
-        if (!enet->sorted_neuron_vector_public[i]->leak) {
-            net_all_leak = false;
-            break;
-        }
-    }
+    net_all_leak = ir->all_leak();
 
-    s = "void run(double duration) {\n";
+    s = gen_run_header_c();
 
     s.add_indent_spaces(4);
 
@@ -309,29 +402,28 @@ std::string EmbeddedRispSoA::gen_run_c() {
          "unsigned int run_time;\n"
          "unsigned int cur_neuron_ind;\n"
          "unsigned int cur_synapse_ind;\n"
+         "unsigned int cur_run_ind;\n"
          "unsigned int to_time;\n"
-         "\n"
+         "charge_t *run_charge;\n"
+         "unsigned char *run_active;\n";
+
+    if (spmv_propagation) {
+        s += "unsigned int cur_row_ind;\n"
+             "unsigned int k;\n"
+             "unsigned int num_fired;\n"
+             "unsigned int row_hits;\n"
+             "charge_t row_charge;\n";
+    }
+
+    s += "\n"
          "/* Clear tracking info on all neurons */\n"
          "for (i = 0; i < NUM_NEURONS; i++) {\n"
          "    neuron_last_fire[i] = -1;\n"
          "    neuron_fire_count[i] = 0;\n"
          "}\n"
-         "\n"
-         "/* Ensure run_time is not negative */\n";
+         "\n";
 
-    if (run_time_inclusive) {
-        s += "if (duration < 0) {\n"
-             "    return;\n"
-             "}\n"
-             "\n"
-             "run_time = (unsigned int)duration;\n";
-    } else {
-        s += "if (duration-1 < 0) {\n"
-             "    return;\n"
-             "}\n"
-             "\n"
-             "run_time = (unsigned int)(duration-1);\n";
-    }
+    s += gen_run_time_c();
 
     s += "\n"
          "for (time = 0; time <= run_time; time++) {\n"
@@ -339,14 +431,27 @@ std::string EmbeddedRispSoA::gen_run_c() {
 
     s.add_indent_spaces(4);
 
-    s += "unsigned int internal_timestep = (current_timestep + time) % "
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_drain_c() + "\n";
+    }
+
+    s += "unsigned int internal_timestep = current_timestep % "
          "MAX_NUM_TIMESTEPS;\n"
-         "\n"
-         "for (cur_neuron_ind = 0; cur_neuron_ind < NUM_NEURONS; "
+         "\n";
+
+    if (spmv_propagation) {
+        s += "num_fired = 0;\n";
+    }
+
+    s += "for (cur_neuron_ind = 0; cur_neuron_ind < NUM_NEURONS; "
          "cur_neuron_ind++) {\n";
 
     s.add_indent_spaces(4);
 
+    if (spmv_propagation) {
+        s += "neuron_fired[cur_neuron_ind] = 0;\n";
+    }
+
     // Min potential
     s += "if (neuron_charge_buffer[internal_timestep][cur_neuron_ind] < "
          "MIN_POTENTIAL) {\n";
@@ -368,25 +473,44 @@ std::string EmbeddedRispSoA::gen_run_c() {
     }
     s.add_indent_spaces(4);
 
-    s += "/* Neuron Fired, loop through synapses */\n";
-    s += "for (cur_synapse_ind = 0; cur_synapse_ind < "
-         "neuron_outgoing[cur_neuron_ind]; cur_synapse_ind++) {\n";
-    s.add_indent_spaces(4);
+    if (spmv_propagation) {
+        s += "/* Neuron fired, its synapses are delivered after the loop */\n"
+             "neuron_fired[cur_neuron_ind] = 1;\n"
+             "num_fired++;\n"
+             "\n";
+    } else {
+        s += "/* Neuron Fired, loop through synapses one delay run at a "
+             "time */\n";
+        s += "cur_synapse_ind = 0;\n";
+        s += "for (cur_run_ind = 0; cur_run_ind < "
+             "neuron_num_runs[cur_neuron_ind]; cur_run_ind++) {\n";
+        s.add_indent_spaces(4);
 
-    s += "neuron_charge_buffer[(internal_timestep + "
-         "synapse_delay[cur_neuron_ind][cur_synapse_ind]) % "
-         "MAX_NUM_TIMESTEPS][synapse_to[cur_neuron_ind][cur_synapse_ind]] += "
-         "synapse_weight[cur_neuron_ind][cur_synapse_ind];\n";
-    s += "neuron_active[(internal_timestep + "
-         "synapse_delay[cur_neuron_ind][cur_synapse_ind]) % "
-         "MAX_NUM_TIMESTEPS][synapse_to[cur_neuron_ind][cur_synapse_ind]] = "
-         "1;\n";
+        s += "to_time = (internal_timestep + "
+             "run_delay[cur_neuron_ind][cur_run_ind]) % MAX_NUM_TIMESTEPS;\n";
+        s += "run_charge = neuron_charge_buffer[to_time];\n";
+        s += "run_active = neuron_active[to_time];\n";
+        s += "for (; cur_synapse_ind < run_end[cur_neuron_ind][cur_run_ind]; "
+             "cur_synapse_ind++) {\n";
+        s.add_indent_spaces(4);
 
-    s.add_indent_spaces(-4);
-    s += "}\n\n";
+        s += "run_charge[synapse_to[cur_neuron_ind][cur_synapse_ind]] += "
+             "synapse_weight[cur_neuron_ind][cur_synapse_ind];\n";
+        s += "run_active[synapse_to[cur_neuron_ind][cur_synapse_ind]] = 1;\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "SNN_STATS_ADD(synapses, cur_synapse_ind);\n"
+             "SNN_STATS_ADD(events, cur_synapse_ind);\n"
+             "\n";
+    }
 
     // Output tracking
     s += "/* Ouptut tracking */\n";
+    s += "SNN_STATS_ADD(fires, 1);\n";
     s += "neuron_fire_count[cur_neuron_ind]++;\n";
     s += "neuron_last_fire[cur_neuron_ind] = time;\n";
     s += "neuron_fire_times[cur_neuron_ind][neuron_fire_count[cur_neuron_ind]] "
@@ -418,6 +542,49 @@ std::string EmbeddedRispSoA::gen_run_c() {
     s += "}\n"
          "\n";
 
+    if (spmv_propagation) {
+        s += "/* Deliver this timestep's fires as one sparse matrix-vector "
+             "product per delay */\n"
+             "if (num_fired > 0) {\n";
+        s.add_indent_spaces(4);
+        s += "for (cur_run_ind = 0; cur_run_ind < NUM_SPMV_DELAYS; "
+             "cur_run_ind++) {\n";
+        s.add_indent_spaces(4);
+        s += "to_time = (internal_timestep + spmv_delay[cur_run_ind]) % "
+             "MAX_NUM_TIMESTEPS;\n"
+             "run_charge = neuron_charge_buffer[to_time];\n"
+             "run_active = neuron_active[to_time];\n"
+             "for (cur_row_ind = spmv_delay_rows[cur_run_ind]; "
+             "cur_row_ind < spmv_delay_rows[cur_run_ind + 1]; "
+             "cur_row_ind++) {\n";
+        s.add_indent_spaces(4);
+        s += "row_charge = 0;\n"
+             "row_hits = 0;\n"
+             "for (k = spmv_row_start[cur_row_ind]; "
+             "k < spmv_row_start[cur_row_ind + 1]; k++) {\n"
+             "    row_charge += spmv_weight[k] * neuron_fired[spmv_col[k]];\n"
+             "    row_hits += neuron_fired[spmv_col[k]];\n"
+             "}\n"
+             "SNN_STATS_ADD(synapses, row_hits);\n"
+             "SNN_STATS_ADD(events, row_hits);\n"
+             "if (row_hits > 0) {\n"
+             "    run_charge[spmv_row_to[cur_row_ind]] += row_charge;\n"
+             "    run_active[spmv_row_to[cur_row_ind]] = 1;\n"
+             "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n";
+        s.add_indent_spaces(-4);
+        s += "}\n"
+             "\n";
+    }
+
+    if (output_callback) {
+        s += gen_output_callback_call_c(
+                 "neuron_last_fire[OUTPUT_IND_TO_NEURON_IND[i]]") + "\n";
+    }
+
     // Loop through and clear row of matrix
     s += "/* Loop through and clear row of matrix (memset to 0) */\n";
     s += "for (cur_neuron_ind = 0; cur_neuron_ind < NUM_NEURONS; "
@@ -426,17 +593,25 @@ std::string EmbeddedRispSoA::gen_run_c() {
     s += "neuron_charge_buffer[internal_timestep][cur_neuron_ind] = 0;\n";
     s += "neuron_active[internal_timestep][cur_neuron_ind] = 0;\n";
     s.add_indent_spaces(-4);
-    s += "}\n";
+    s += "}\n"
+         "\n"
+         "current_timestep++;\n"
+         "SNN_STATS_ADD(timesteps, 1);\n";
+
+    if (run_until) {
+        s += "\n" +
+             gen_run_until_check_c(
+                 "neuron_last_fire[OUTPUT_IND_TO_NEURON_IND[i]]",
+                 "neuron_fire_count[OUTPUT_IND_TO_NEURON_IND[i]]");
+    }
 
     s.add_indent_spaces(-4);
 
-    s += "}\n"
-         "\n";
+    s += "}\n";
 
-    if (run_time_inclusive) {
-        s += "current_timestep += duration + 1;\n";
-    } else {
-        s += "current_timestep += duration;\n";
+    if (run_until) {
+        s += "\n"
+             "return time;\n";
     }
 
     s.add_indent_spaces(-4);
@@ -446,6 +621,35 @@ std::string EmbeddedRispSoA::gen_run_c() {
     return s.get_str();
 }
 
+std::string EmbeddedRispSoA::gen_network_quiescent_c() {
+    IndentString s;
+
+    s = "/* This function will return 1 if no spikes are in flight in the SNN "
+        "and 0 otherwise. */\n"
+        "int network_quiescent(void) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    for (j = 0; j < NUM_NEURONS; j++) {\n"
+         "        if (neuron_active[i][j]) {\n"
+         "            return 0;\n"
+         "        }\n"
+         "    }\n"
+         "}\n"
+         "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
 std::string EmbeddedRispSoA::gen_clear_activity_c() {
     IndentString s;
 
@@ -0,0 +1,625 @@
+#include "EmbeddedRispStatic.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+
+EmbeddedRispStatic::EmbeddedRispStatic(neuro::json &params)
+    : EmbeddedRisp(params) {
+    num_history_words = 0;
+}
+
+EmbeddedRispStatic::~EmbeddedRispStatic() {}
+
+/* Kahn's algorithm over the synapse graph. A neuron's layer is the length of
+ * the longest synapse path that reaches it, so every neuron comes after all
+ * of its sources in the schedule. Returns false if the graph has a cycle
+ * (including a self-loop). */
+bool EmbeddedRispStatic::compute_layers() {
+    std::vector<unsigned int> in_degree;
+    std::vector<unsigned int> ready;
+    unsigned int i;
+    unsigned int j;
+    unsigned int v;
+    unsigned int to;
+
+    in_degree.assign(ir->num_neurons(), 0);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            in_degree[ir->neurons[i].synapses[j].to]++;
+        }
+    }
+
+    neuron_layer.assign(ir->num_neurons(), 0);
+    schedule.clear();
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (in_degree[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+
+    while (!ready.empty()) {
+        v = ready.back();
+        ready.pop_back();
+        schedule.push_back(v);
+
+        for (j = 0; j < ir->neurons[v].synapses.size(); j++) {
+            to = ir->neurons[v].synapses[j].to;
+            neuron_layer[to] = std::max(neuron_layer[to], neuron_layer[v] + 1);
+            in_degree[to]--;
+            if (in_degree[to] == 0) {
+                ready.push_back(to);
+            }
+        }
+    }
+
+    if (schedule.size() != ir->num_neurons()) {
+        return false;
+    }
+
+    std::stable_sort(schedule.begin(), schedule.end(),
+                     [this](unsigned int a, unsigned int b) {
+                         if (neuron_layer[a] != neuron_layer[b]) {
+                             return neuron_layer[a] < neuron_layer[b];
+                         }
+                         return a < b;
+                     });
+
+    return true;
+}
+
+/* Every timestep visits every neuron that an input or a synapse can spike and
+ * tests the fire history bit of each of its incoming synapses, which is
+ * counted as a synapse traversal. The sparse fallback keeps the event-driven
+ * counts. */
+void EmbeddedRispStatic::wcet_bounds(unsigned int &events,
+                                     unsigned int &checks,
+                                     unsigned int &fires,
+                                     unsigned int &synapses) {
+    std::vector<bool> visited;
+    unsigned int i;
+    unsigned int j;
+
+    EmbeddedRisp::wcet_bounds(events, checks, fires, synapses);
+    if (fire_like_ravens || !compute_layers()) {
+        return;
+    }
+
+    visited.assign(ir->num_neurons(), false);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (ir->neurons[i].input_id >= 0) {
+            visited[i] = true;
+        }
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            visited[ir->neurons[i].synapses[j].to] = true;
+        }
+    }
+
+    checks = std::count(visited.begin(), visited.end(), true);
+    synapses = ir->num_synapses();
+}
+
+std::string EmbeddedRispStatic::gen_static_c(unsigned int max_num_timesteps) {
+    IndentString s;
+    unsigned int i;
+    unsigned int j;
+    unsigned int max_out_delay;
+
+    if (fire_like_ravens) {
+        fprintf(stderr, "Warning: EmbeddedRispStatic does not support the "
+                        "fire_like_ravens flag, generating sparse RISP code "
+                        "instead.\n");
+        return EmbeddedRisp::gen_static_c(max_num_timesteps);
+    }
+
+    if (!compute_layers()) {
+        fprintf(stderr, "Warning: EmbeddedRispStatic needs a feed-forward "
+                        "network and this network is recurrent, generating "
+                        "sparse RISP code instead.\n");
+        return EmbeddedRisp::gen_static_c(max_num_timesteps);
+    }
+
+    /* A neuron's shift register needs one bit per timestep back to its
+     * longest outgoing delay; bit d is set if the neuron fired d timesteps
+     * ago */
+    num_history_words = 0;
+    history_offset.assign(ir->num_neurons(), 0);
+    history_words.assign(ir->num_neurons(), 0);
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (ir->neurons[i].synapses.empty()) {
+            continue;
+        }
+
+        max_out_delay = 0;
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            max_out_delay =
+                std::max(max_out_delay, ir->neurons[i].synapses[j].delay);
+        }
+
+        history_offset[i] = num_history_words;
+        history_words[i] = max_out_delay / 64 + 1;
+        num_history_words += history_words[i];
+    }
+
+    s = "/*************** RISP STATIC NETWORK CODE ********************/\n"
+        "\n" +
+        gen_defines_c(max_num_timesteps) + "#define NUM_HISTORY_WORDS (" +
+        std::to_string(std::max(num_history_words, 1u)) +
+        ")\n"
+        "\n";
+
+    s += gen_io_tables_c();
+
+    s += "\n"
+         "charge_t neuron_charge[NUM_NEURONS] = {0};                    "
+         "/* Charge of every neuron */\n"
+         "unsigned long long fire_history[NUM_HISTORY_WORDS] = {0};     "
+         "/* Per-neuron shift registers of recent fires */\n"
+         "charge_t input_charge[MAX_NUM_TIMESTEPS][NUM_INPUT_NEURONS];  "
+         "/* Pending input spike charge keyed on timestep */\n"
+         "unsigned char input_active[MAX_NUM_TIMESTEPS][NUM_INPUT_NEURONS]; "
+         "/* Whether an input spike is pending */\n"
+         "unsigned int cur_input_slot = 0;                              "
+         "/* Row of the input arrays for the upcoming timestep */\n"
+         "unsigned int output_fire_counts[NUM_OUTPUT_NEURONS] = {0};    "
+         "/* Fires of each output during the last run */\n"
+         "int output_last_fires[NUM_OUTPUT_NEURONS] = {";
+    for (i = 0; i < ir->num_outputs; i++) {
+        s += "-1";
+        if (i != ir->num_outputs - 1) {
+            s += ", ";
+        }
+    }
+    s += "}; /* Last fire time of each output during the last run */\n";
+
+    if (ir->has_leak()) {
+        s += "unsigned char neuron_leak[NUM_NEURONS] = {\n    ";
+        for (i = 0; i < ir->neurons.size(); i++) {
+            s += std::to_string((unsigned char)ir->neurons[i].leak);
+            if (i != ir->neurons.size() - 1) {
+                s += ", ";
+            }
+        }
+        s += "\n};\n";
+    }
+
+    s += "\n";
+
+    s += gen_apply_spike_c() + "\n";
+    if (spike_queue_size > 0) {
+        s += gen_spike_queue_c() + "\n";
+    }
+    if (output_callback) {
+        s += gen_output_callback_c() + "\n";
+    }
+    if (run_until) {
+        s += gen_run_until_defines_c() + "\n" + gen_network_quiescent_c() +
+             "\n";
+    }
+    s += gen_run_c() + "\n";
+    if (run_until) {
+        s += gen_run_until_wrapper_c() + "\n";
+    }
+    s += gen_clear_activity_c() + "\n";
+    s += gen_output_last_fire_c() + "\n";
+    s += gen_output_count_c();
+    if (tick) {
+        s += "\n" + gen_tick_c();
+    }
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispStatic::gen_apply_spike_c() {
+    IndentString s;
+
+    s = "/* This function will apply a spike of potential value value to the "
+        "input neuron with an input neuron zero-based index of input_ind at "
+        "time time relative to the current timestep of the neuroprocessor. */\n"
+        "void apply_spike(unsigned int input_ind, unsigned int time, double "
+        "value) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int slot;\n"
+         "\n"
+         "/* Ensure input neuron index is not out of bounds */\n"
+         "if (input_ind >= NUM_INPUT_NEURONS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "/* Ensure time is not out of bounds */\n"
+         "if (time >= MAX_NUM_TIMESTEPS) {\n"
+         "    return;\n"
+         "}\n"
+         "\n"
+         "slot = cur_input_slot + time;\n"
+         "if (slot >= MAX_NUM_TIMESTEPS) {\n"
+         "    slot -= MAX_NUM_TIMESTEPS;\n"
+         "}\n"
+         "\n"
+         "input_charge[slot][input_ind] += SPIKE_CHARGE(value);\n"
+         "input_active[slot][input_ind] = 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* The timestep loop is fully unrolled over the schedule. For each neuron the
+ * generated code tests the shift register bit of every incoming synapse; any
+ * set bit (or a pending input spike) is an event, which leaks and clamps the
+ * neuron, adds the charges and checks the threshold exactly like the sparse
+ * backend. Sources come earlier in the schedule and have already shifted in
+ * this timestep's fire, so a synapse of delay d tests bit d. */
+std::string EmbeddedRispStatic::gen_run_c() {
+    std::vector<std::vector<std::pair<unsigned int, const IRSynapse *>>> in;
+    std::vector<std::string> event_terms;
+    IndentString s;
+    const IRNeuron *n;
+    std::string charge;
+    std::string bit;
+    unsigned int i;
+    unsigned int j;
+    unsigned int k;
+    unsigned int cur;
+    unsigned int word;
+    unsigned int layer;
+    bool net_has_leak;
+
+    net_has_leak = ir->has_leak();
+
+    in.resize(ir->num_neurons());
+    for (i = 0; i < ir->num_neurons(); i++) {
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            in[ir->neurons[i].synapses[j].to].push_back(
+                std::make_pair(i, &ir->neurons[i].synapses[j]));
+        }
+    }
+
+    s = gen_run_header_c();
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int time;\n"
+         "unsigned int i;\n"
+         "unsigned int run_time;\n"
+         "unsigned char event;\n"
+         "unsigned long long fired;\n"
+         "\n"
+         "/* Clear tracking info on all output neurons */\n"
+         "for (i = 0; i < NUM_OUTPUT_NEURONS; i++) {\n"
+         "    output_last_fires[i] = -1;\n"
+         "    output_fire_counts[i] = 0;\n"
+         "}\n"
+         "\n";
+
+    s += gen_run_time_c();
+
+    s += "\n"
+         "for (time = 0; time <= run_time; time++) {\n";
+
+    s.add_indent_spaces(4);
+
+    if (spike_queue_size > 0) {
+        s += "\n" + gen_spike_queue_drain_c();
+    }
+
+    layer = (unsigned int)-1;
+    for (i = 0; i < schedule.size(); i++) {
+        cur = schedule[i];
+        n = &ir->neurons[cur];
+
+        /* A neuron that nothing can spike never fires */
+        if (in[cur].empty() && n->input_id < 0) {
+            continue;
+        }
+
+        if (neuron_layer[cur] != layer) {
+            layer = neuron_layer[cur];
+            s += "\n/* Layer " + std::to_string(layer) + " */\n";
+        }
+
+        charge = "neuron_charge[" + std::to_string(cur) + "]";
+
+        event_terms.clear();
+        if (n->input_id >= 0) {
+            event_terms.push_back("input_active[cur_input_slot][" +
+                                  std::to_string(n->input_id) + "]");
+        }
+        for (j = 0; j < in[cur].size(); j++) {
+            word = history_offset[in[cur][j].first] +
+                   in[cur][j].second->delay / 64;
+            bit = "((fire_history[" + std::to_string(word) + "] >> " +
+                  std::to_string(in[cur][j].second->delay % 64) + ") & 1)";
+            event_terms.push_back(bit);
+        }
+
+        s += "/* Neuron " + std::to_string(cur) + " (node " +
+             std::to_string(n->id) + ") */\n";
+        s += "event = " + event_terms[0] + ";\n";
+        for (j = 1; j < event_terms.size(); j++) {
+            s += "event |= " + event_terms[j] + ";\n";
+        }
+        if (!n->synapses.empty()) {
+            s += "fired = 0;\n";
+        }
+
+        s += "if (event) {\n";
+        s.add_indent_spaces(4);
+
+        if (n->leak) {
+            s += charge + " = 0;\n";
+        }
+        s += "if (" + charge + " < MIN_POTENTIAL) {\n"
+             "    " + charge + " = MIN_POTENTIAL;\n"
+             "}\n";
+
+        k = 0;
+        if (n->input_id >= 0) {
+            s += charge + " += input_charge[cur_input_slot][" +
+                 std::to_string(n->input_id) + "];\n"
+                 "SNN_STATS_ADD(events, input_active[cur_input_slot][" +
+                 std::to_string(n->input_id) + "]);\n";
+            k = 1;
+        }
+        for (j = 0; j < in[cur].size(); j++) {
+            s += "if " + event_terms[k + j] + " {\n"
+                 "    " + charge + " += " +
+                 real_c(in[cur][j].second->weight) + ";\n"
+                 "    SNN_STATS_ADD(events, 1);\n"
+                 "}\n";
+        }
+
+        s += "if (" + charge + (threshold_inclusive ? " >= " : " > ") +
+             real_c(n->threshold) + ") {\n";
+        s.add_indent_spaces(4);
+        s += charge + " = 0;\n"
+             "SNN_STATS_ADD(fires, 1);\n";
+        if (!n->synapses.empty()) {
+            s += "SNN_STATS_ADD(synapses, " +
+                 std::to_string(n->synapses.size()) + ");\n"
+                 "fired = 1;\n";
+        }
+        if (n->output_id >= 0) {
+            s += "output_fire_counts[" + std::to_string(n->output_id) +
+                 "]++;\n"
+                 "output_last_fires[" + std::to_string(n->output_id) +
+                 "] = time;\n";
+        }
+        s.add_indent_spaces(-4);
+        s += "}\n";
+
+        s.add_indent_spaces(-4);
+        s += "}\n";
+
+        /* Shift this timestep's fire into the register, high word first */
+        for (j = history_words[cur]; j > 0; j--) {
+            word = history_offset[cur] + j - 1;
+            if (j > 1) {
+                s += "fire_history[" + std::to_string(word) +
+                     "] = (fire_history[" + std::to_string(word) +
+                     "] << 1) | (fire_history[" + std::to_string(word - 1) +
+                     "] >> 63);\n";
+            } else {
+                s += "fire_history[" + std::to_string(word) +
+                     "] = (fire_history[" + std::to_string(word) +
+                     "] << 1) | fired;\n";
+            }
+        }
+    }
+
+    if (output_callback) {
+        s += "\n" + gen_output_callback_call_c("output_last_fires[i]");
+    }
+
+    s += "\n"
+         "/* Consume this timestep's input spikes */\n"
+         "for (i = 0; i < NUM_INPUT_NEURONS; i++) {\n"
+         "    input_charge[cur_input_slot][i] = 0;\n"
+         "    input_active[cur_input_slot][i] = 0;\n"
+         "}\n"
+         "cur_input_slot++;\n"
+         "if (cur_input_slot == MAX_NUM_TIMESTEPS) {\n"
+         "    cur_input_slot = 0;\n"
+         "}\n"
+         "SNN_STATS_ADD(timesteps, 1);\n";
+
+    if (run_until) {
+        s += "\n" +
+             gen_run_until_check_c(
+                 "output_last_fires[i]",
+                 "output_fire_counts[i]");
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n"
+         "\n";
+
+    if (net_has_leak) {
+        s += "/* Apply leak and reset minimum charge before the next run */\n";
+    } else {
+        s += "/* Reset minimum charge before the next run */\n";
+    }
+
+    s += "for (i = 0; i < NUM_NEURONS; i++) {\n";
+
+    s.add_indent_spaces(4);
+
+    if (net_has_leak) {
+        s += "if (neuron_leak[i] == 1) {\n"
+             "    neuron_charge[i] = 0;\n"
+             "}\n";
+    }
+
+    s += "if (neuron_charge[i] < MIN_POTENTIAL) {\n"
+         "    neuron_charge[i] = MIN_POTENTIAL;\n"
+         "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    if (run_until) {
+        s += "\n"
+             "return time;\n";
+    }
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+/* Bit p of a neuron's shift register is the fire of p timesteps ago, which
+ * is still in flight while p is below the neuron's longest outgoing delay */
+std::string EmbeddedRispStatic::gen_network_quiescent_c() {
+    IndentString s;
+    unsigned int i;
+    unsigned int j;
+    unsigned int max_out_delay;
+    unsigned int bits;
+    unsigned long long mask;
+
+    s = "/* This function will return 1 if no spikes are in flight in the SNN "
+        "and 0 otherwise. */\n"
+        "int network_quiescent(void) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    for (j = 0; j < NUM_INPUT_NEURONS; j++) {\n"
+         "        if (input_active[i][j]) {\n"
+         "            return 0;\n"
+         "        }\n"
+         "    }\n"
+         "}\n"
+         "\n";
+
+    for (i = 0; i < ir->num_neurons(); i++) {
+        if (ir->neurons[i].synapses.empty()) {
+            continue;
+        }
+
+        max_out_delay = 0;
+        for (j = 0; j < ir->neurons[i].synapses.size(); j++) {
+            max_out_delay =
+                std::max(max_out_delay, ir->neurons[i].synapses[j].delay);
+        }
+
+        for (j = 0; j < history_words[i] && j * 64 < max_out_delay; j++) {
+            bits = std::min(max_out_delay - j * 64, 64u);
+            mask = (bits == 64) ? ~0ULL : (1ULL << bits) - 1;
+            s += "if ((fire_history[" +
+                 std::to_string(history_offset[i] + j) + "] & " +
+                 std::to_string(mask) + "ULL) != 0) {\n"
+                 "    return 0;\n"
+                 "}\n";
+        }
+    }
+
+    s += "\n"
+         "return 1;\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispStatic::gen_clear_activity_c() {
+    IndentString s;
+
+    s = "/* This function will clear the SNN of all activity. It resets all "
+        "neuron and synapse state. */\n"
+        "void clear_activity() {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "unsigned int i;\n"
+         "unsigned int j;\n"
+         "\n"
+         "/* Clear activity-related neuron state */\n"
+         "for (i = 0; i < NUM_NEURONS; i++) {\n"
+         "    neuron_charge[i] = 0;\n"
+         "}\n"
+         "for (i = 0; i < NUM_OUTPUT_NEURONS; i++) {\n"
+         "    output_last_fires[i] = -1;\n"
+         "    output_fire_counts[i] = 0;\n"
+         "}\n"
+         "\n"
+         "/* Clear all spikes in flight */\n"
+         "for (i = 0; i < NUM_HISTORY_WORDS; i++) {\n"
+         "    fire_history[i] = 0;\n"
+         "}\n"
+         "for (i = 0; i < MAX_NUM_TIMESTEPS; i++) {\n"
+         "    for (j = 0; j < NUM_INPUT_NEURONS; j++) {\n"
+         "        input_charge[i][j] = 0;\n"
+         "        input_active[i][j] = 0;\n"
+         "    }\n"
+         "}\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispStatic::gen_output_last_fire_c() {
+    IndentString s;
+
+    s = "/* This function will return the timestep of the output neuron with "
+        "an output neuron zero-based index of output_ind. The returned "
+        "timestep will only be for the most recent call of the run() function. "
+        "*/\n"
+        "double output_last_fire(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return -1;\n"
+         "}\n"
+         "\n"
+         "return (double)output_last_fires[output_ind];\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
+
+std::string EmbeddedRispStatic::gen_output_count_c() {
+    IndentString s;
+
+    s = "/* This function will return the number of neuronal fires for the "
+        "output neuron with an output neuron zero-based index of output_ind. "
+        "The returned fire count will only be for the most recent call of the "
+        "run() function. */\n"
+        "unsigned int output_count(unsigned int output_ind) {\n";
+
+    s.add_indent_spaces(4);
+
+    s += "\n"
+         "/* Ensure output index not out of bounds */\n"
+         "if (output_ind >= NUM_OUTPUT_NEURONS) {\n"
+         "    return 0;\n"
+         "}\n"
+         "\n"
+         "return output_fire_counts[output_ind];\n";
+
+    s.add_indent_spaces(-4);
+
+    s += "}\n";
+
+    return s.get_str();
+}
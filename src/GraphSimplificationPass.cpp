@@ -0,0 +1,143 @@
+#include "Passes.hpp"
+#include <algorithm>
+#include <map>
+#include <utility>
+
+std::string GraphSimplificationPass::name() const { return "simplify"; }
+
+bool GraphSimplificationPass::run(NetworkIR &ir) {
+    bool changed;
+    bool any_change;
+
+    any_change = false;
+    do {
+        changed = merge_parallel_synapses(ir);
+        changed = collapse_relay_neurons(ir) || changed;
+        any_change = any_change || changed;
+    } while (changed);
+
+    return any_change;
+}
+
+/* Events that land on the same neuron in the same timestep are leaked and
+ * clamped first and then summed, so parallel synapses with equal delays act
+ * as one synapse with the summed weight. The merged synapse is kept even if
+ * its weight sums to 0, since the event still leaks and clamps its target.
+ * Summing is only exact for discrete weights, so non-discrete networks are
+ * left alone. */
+bool GraphSimplificationPass::merge_parallel_synapses(NetworkIR &ir) {
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int> first;
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int>::iterator it;
+    std::vector<IRSynapse> kept;
+    IRSynapse *syn;
+    unsigned int i;
+    unsigned int j;
+    bool changed;
+
+    if (!ir.discrete) {
+        return false;
+    }
+
+    changed = false;
+    for (i = 0; i < ir.num_neurons(); i++) {
+        first.clear();
+        kept.clear();
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            syn = &ir.neurons[i].synapses[j];
+            it = first.find(std::make_pair(syn->to, syn->delay));
+            if (it == first.end()) {
+                first[std::make_pair(syn->to, syn->delay)] = kept.size();
+                kept.push_back(*syn);
+            } else {
+                kept[it->second].weight += syn->weight;
+                changed = true;
+            }
+        }
+        ir.neurons[i].synapses = kept;
+    }
+
+    return changed;
+}
+
+/* A relay is a hidden neuron with a single incoming synapse whose weight
+ * alone fires it. Such a neuron fires on every incoming spike, so its charge
+ * is back at 0 (or MIN_POTENTIAL after a clamp) before each event, and its
+ * outgoing synapses can hang off its predecessor with the two delays added.
+ * This holds with or without leak. Relays are only folded when every
+ * resulting delay stays within the processor's max_delay. */
+bool GraphSimplificationPass::collapse_relay_neurons(NetworkIR &ir) {
+    std::vector<unsigned int> in_count;
+    std::vector<unsigned int> pred;
+    std::vector<bool> remove;
+    std::vector<IRSynapse> *pred_synapses;
+    IRSynapse syn;
+    IRSynapse in_syn;
+    double base;
+    unsigned int i;
+    unsigned int j;
+    unsigned int k;
+    bool fires;
+    bool fits;
+    bool changed;
+
+    base = std::max(0.0, ir.min_potential);
+
+    in_count.assign(ir.num_neurons(), 0);
+    pred.assign(ir.num_neurons(), 0);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            in_count[ir.neurons[i].synapses[j].to]++;
+            pred[ir.neurons[i].synapses[j].to] = i;
+        }
+    }
+
+    changed = false;
+    remove.assign(ir.num_neurons(), false);
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].input_id >= 0 || ir.neurons[i].output_id >= 0 ||
+            in_count[i] != 1 || pred[i] == i) {
+            continue;
+        }
+
+        pred_synapses = &ir.neurons[pred[i]].synapses;
+        for (k = 0; (*pred_synapses)[k].to != i; k++) {
+        }
+        in_syn = (*pred_synapses)[k];
+
+        if (ir.threshold_inclusive) {
+            fires = (base + in_syn.weight >= ir.neurons[i].threshold);
+        } else {
+            fires = (base + in_syn.weight > ir.neurons[i].threshold);
+        }
+
+        fits = true;
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            if (in_syn.delay + ir.neurons[i].synapses[j].delay >
+                ir.proc_max_delay) {
+                fits = false;
+            }
+        }
+
+        if (!fires || !fits) {
+            continue;
+        }
+
+        pred_synapses->erase(pred_synapses->begin() + k);
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            syn = ir.neurons[i].synapses[j];
+            syn.delay += in_syn.delay;
+            pred_synapses->push_back(syn);
+            pred[syn.to] = pred[i];
+        }
+        ir.neurons[i].synapses.clear();
+        in_count[i] = 0;
+        remove[i] = true;
+        changed = true;
+    }
+
+    if (changed) {
+        ir.remove_neurons(remove);
+    }
+
+    return changed;
+}
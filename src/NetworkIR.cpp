@@ -0,0 +1,324 @@
+#include "NetworkIR.hpp"
+#include <unordered_map>
+
+NetworkIR::NetworkIR() {
+    num_inputs = 0;
+    num_outputs = 0;
+    min_potential = 0;
+    spike_value_factor = 1;
+    threshold_inclusive = true;
+    run_time_inclusive = false;
+    fire_like_ravens = false;
+    discrete = true;
+    proc_max_delay = 0;
+}
+
+void NetworkIR::build(neuro::Network *net,
+                      const std::vector<risp::Neuron *> &sorted_neurons) {
+    std::unordered_map<uint32_t, unsigned int> neuron_id_to_ind;
+    risp::Neuron *cur_neuron;
+    neuro::Node *cur_node;
+    IRSynapse syn;
+    unsigned int i;
+    unsigned int j;
+
+    neurons.clear();
+    neurons.resize(sorted_neurons.size());
+    for (i = 0; i < sorted_neurons.size(); i++) {
+        neuron_id_to_ind[sorted_neurons[i]->id] = i;
+    }
+
+    for (i = 0; i < sorted_neurons.size(); i++) {
+        cur_neuron = sorted_neurons[i];
+        neurons[i].id = cur_neuron->id;
+        neurons[i].threshold = cur_neuron->threshold;
+        neurons[i].leak = cur_neuron->leak;
+        neurons[i].input_id = -1;
+        neurons[i].output_id = -1;
+
+        for (j = 0; j < cur_neuron->synapses.size(); j++) {
+            syn.to = neuron_id_to_ind[cur_neuron->synapses[j]->to->id];
+            syn.delay = cur_neuron->synapses[j]->delay;
+            syn.weight = cur_neuron->synapses[j]->weight;
+            neurons[i].synapses.push_back(syn);
+        }
+    }
+
+    net->make_sorted_node_vector();
+    for (i = 0; i < net->sorted_node_vector.size(); i++) {
+        cur_node = net->sorted_node_vector[i];
+        if (cur_node->is_input()) {
+            neurons[neuron_id_to_ind[cur_node->id]].input_id =
+                cur_node->input_id;
+        }
+        if (cur_node->is_output()) {
+            neurons[neuron_id_to_ind[cur_node->id]].output_id =
+                cur_node->output_id;
+        }
+    }
+
+    num_inputs = net->num_inputs();
+    num_outputs = net->num_outputs();
+}
+
+unsigned int NetworkIR::num_neurons() const { return neurons.size(); }
+
+unsigned int NetworkIR::num_synapses() const {
+    unsigned int i;
+    unsigned int n;
+
+    n = 0;
+    for (i = 0; i < neurons.size(); i++) {
+        n += neurons[i].synapses.size();
+    }
+
+    return n;
+}
+
+unsigned int NetworkIR::max_outgoing() const {
+    unsigned int i;
+    unsigned int m;
+
+    m = 0;
+    for (i = 0; i < neurons.size(); i++) {
+        if (neurons[i].synapses.size() > m) {
+            m = neurons[i].synapses.size();
+        }
+    }
+
+    return m;
+}
+
+unsigned int NetworkIR::max_delay() const {
+    unsigned int i;
+    unsigned int j;
+    unsigned int m;
+
+    m = 0;
+    for (i = 0; i < neurons.size(); i++) {
+        for (j = 0; j < neurons[i].synapses.size(); j++) {
+            if (neurons[i].synapses[j].delay > m) {
+                m = neurons[i].synapses[j].delay;
+            }
+        }
+    }
+
+    return m;
+}
+
+bool NetworkIR::has_leak() const {
+    unsigned int i;
+
+    for (i = 0; i < neurons.size(); i++) {
+        if (neurons[i].leak) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool NetworkIR::all_leak() const {
+    unsigned int i;
+
+    for (i = 0; i < neurons.size(); i++) {
+        if (!neurons[i].leak) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned int NetworkIR::max_delay_runs() const {
+    unsigned int i;
+    unsigned int m;
+
+    m = 0;
+    for (i = 0; i < neurons.size(); i++) {
+        if (delay_runs(i).size() > m) {
+            m = delay_runs(i).size();
+        }
+    }
+
+    return m;
+}
+
+std::vector<unsigned int> NetworkIR::input_ind_to_neuron_ind() const {
+    std::vector<unsigned int> v;
+    unsigned int i;
+
+    v.resize(num_inputs);
+    for (i = 0; i < neurons.size(); i++) {
+        if (neurons[i].input_id >= 0) {
+            v[neurons[i].input_id] = i;
+        }
+    }
+
+    return v;
+}
+
+std::vector<unsigned int> NetworkIR::output_ind_to_neuron_ind() const {
+    std::vector<unsigned int> v;
+    unsigned int i;
+
+    v.resize(num_outputs);
+    for (i = 0; i < neurons.size(); i++) {
+        if (neurons[i].output_id >= 0) {
+            v[neurons[i].output_id] = i;
+        }
+    }
+
+    return v;
+}
+
+std::vector<std::vector<unsigned int>> NetworkIR::incoming_neurons() const {
+    std::vector<std::vector<unsigned int>> in;
+    unsigned int i;
+    unsigned int j;
+
+    in.resize(neurons.size());
+    for (i = 0; i < neurons.size(); i++) {
+        for (j = 0; j < neurons[i].synapses.size(); j++) {
+            in[neurons[i].synapses[j].to].push_back(i);
+        }
+    }
+
+    return in;
+}
+
+/* Maximal runs of consecutive outgoing synapses with equal delays, as
+ * (delay, end) pairs where end is one past the last synapse of the run */
+std::vector<std::pair<unsigned int, unsigned int>>
+NetworkIR::delay_runs(unsigned int neuron_ind) const {
+    std::vector<std::pair<unsigned int, unsigned int>> runs;
+    const std::vector<IRSynapse> &synapses = neurons[neuron_ind].synapses;
+    unsigned int j;
+
+    for (j = 0; j < synapses.size(); j++) {
+        if (j == 0 || synapses[j].delay != synapses[j - 1].delay) {
+            runs.push_back(std::make_pair(synapses[j].delay, j + 1));
+        } else {
+            runs.back().second = j + 1;
+        }
+    }
+
+    return runs;
+}
+
+/* Drop every neuron flagged in remove along with all synapses touching it,
+ * then compact the remaining neurons and renumber synapse targets. */
+void NetworkIR::remove_neurons(const std::vector<bool> &remove) {
+    std::vector<IRNeuron> kept;
+    std::vector<unsigned int> old_to_new;
+    std::vector<IRSynapse> synapses;
+    unsigned int i;
+    unsigned int j;
+
+    old_to_new.resize(neurons.size());
+    for (i = 0; i < neurons.size(); i++) {
+        if (!remove[i]) {
+            old_to_new[i] = kept.size();
+            kept.push_back(neurons[i]);
+        }
+    }
+
+    for (i = 0; i < kept.size(); i++) {
+        synapses.clear();
+        for (j = 0; j < kept[i].synapses.size(); j++) {
+            if (!remove[kept[i].synapses[j].to]) {
+                synapses.push_back(kept[i].synapses[j]);
+                synapses.back().to = old_to_new[kept[i].synapses[j].to];
+            }
+        }
+        kept[i].synapses = synapses;
+    }
+
+    neurons = kept;
+}
+
+/* new_to_old[k] is the current index of the neuron that becomes neuron k */
+void NetworkIR::reorder_neurons(const std::vector<unsigned int> &new_to_old) {
+    std::vector<IRNeuron> reordered;
+    std::vector<unsigned int> old_to_new;
+    unsigned int i;
+    unsigned int j;
+
+    if (new_to_old.size() != neurons.size()) {
+        throw(std::string) "NetworkIR::reorder_neurons() - permutation size "
+                           "does not match the number of neurons";
+    }
+
+    old_to_new.resize(neurons.size());
+    for (i = 0; i < new_to_old.size(); i++) {
+        old_to_new[new_to_old[i]] = i;
+        reordered.push_back(neurons[new_to_old[i]]);
+    }
+
+    for (i = 0; i < reordered.size(); i++) {
+        for (j = 0; j < reordered[i].synapses.size(); j++) {
+            reordered[i].synapses[j].to =
+                old_to_new[reordered[i].synapses[j].to];
+        }
+    }
+
+    neurons = reordered;
+}
+
+/* Check the invariants every code generator relies on */
+void NetworkIR::verify() const {
+    std::vector<bool> input_seen;
+    std::vector<bool> output_seen;
+    unsigned int i;
+    unsigned int j;
+
+    input_seen.assign(num_inputs, false);
+    output_seen.assign(num_outputs, false);
+
+    for (i = 0; i < neurons.size(); i++) {
+        if (neurons[i].input_id >= 0) {
+            if ((unsigned int)neurons[i].input_id >= num_inputs ||
+                input_seen[neurons[i].input_id]) {
+                throw "Network IR verification failed: bad input id on node " +
+                    std::to_string(neurons[i].id);
+            }
+            input_seen[neurons[i].input_id] = true;
+        }
+
+        if (neurons[i].output_id >= 0) {
+            if ((unsigned int)neurons[i].output_id >= num_outputs ||
+                output_seen[neurons[i].output_id]) {
+                throw "Network IR verification failed: bad output id on "
+                      "node " +
+                    std::to_string(neurons[i].id);
+            }
+            output_seen[neurons[i].output_id] = true;
+        }
+
+        for (j = 0; j < neurons[i].synapses.size(); j++) {
+            if (neurons[i].synapses[j].to >= neurons.size()) {
+                throw "Network IR verification failed: synapse from node " +
+                    std::to_string(neurons[i].id) +
+                    " targets a neuron that does not exist";
+            }
+            if (neurons[i].synapses[j].delay < 1) {
+                throw "Network IR verification failed: synapse from node " +
+                    std::to_string(neurons[i].id) + " has a delay below 1";
+            }
+        }
+    }
+
+    for (i = 0; i < num_inputs; i++) {
+        if (!input_seen[i]) {
+            throw "Network IR verification failed: input " +
+                std::to_string(i) + " has no neuron";
+        }
+    }
+
+    for (i = 0; i < num_outputs; i++) {
+        if (!output_seen[i]) {
+            throw "Network IR verification failed: output " +
+                std::to_string(i) + " has no neuron";
+        }
+    }
+}
@@ -0,0 +1,227 @@
+#include "NetworkProfile.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/* Co-firing is only recorded among the first MAX_CO_FIRE_NEURONS neurons that
+ * fire in a timestep, which bounds the cost of bursts to a constant */
+#define MAX_CO_FIRE_NEURONS (64)
+
+NetworkProfile::NetworkProfile() {
+    peak_events = 0;
+    now = 0;
+}
+
+void NetworkProfile::load(const std::string &path) {
+    std::ifstream fin(path);
+    std::string line;
+    std::string token;
+    std::vector<std::string> tokens;
+
+    if (!fin.is_open()) {
+        throw "Cannot open profile stimulus file " + path;
+    }
+
+    commands.clear();
+    while (std::getline(fin, line)) {
+        std::stringstream ss(line);
+
+        tokens.clear();
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+        if (!tokens.empty()) {
+            commands.push_back(tokens);
+        }
+    }
+}
+
+/* Mirrors the timestep semantics of the generated code: events for a
+ * timestep first leak and clamp their target, then add their charge, and
+ * then every target is checked against its threshold. */
+void NetworkProfile::run(const NetworkIR &ir) {
+    unsigned int i;
+    unsigned int j;
+    long long t;
+    long long run_time;
+    double duration;
+
+    fire_counts.assign(ir.num_neurons(), 0);
+    co_fires.clear();
+    peak_events = 0;
+
+    charge.assign(ir.num_neurons(), 0);
+    check.assign(ir.num_neurons(), false);
+    events.clear();
+    to_fire.clear();
+    now = 0;
+
+    // Stimulus commands name input neurons by node id
+    input_neurons.clear();
+    for (i = 0; i < ir.num_neurons(); i++) {
+        if (ir.neurons[i].input_id >= 0) {
+            input_neurons[ir.neurons[i].id] = i;
+        }
+    }
+
+    try {
+        for (i = 0; i < commands.size(); i++) {
+            const std::vector<std::string> &c = commands[i];
+
+            if (c[0] == "AS") {
+                for (j = 1; j + 2 < c.size(); j += 3) {
+                    apply_spike(ir, std::stoul(c[j]), std::stoll(c[j + 1]),
+                                std::stod(c[j + 2]));
+                }
+            } else if (c[0] == "ASR" && c.size() > 2) {
+                // Like the harnesses, a 0 in the raster is a spike of value
+                // 0, which still takes an event slot
+                for (j = 0; j < c[2].size(); j++) {
+                    apply_spike(ir, std::stoul(c[1]), j, c[2][j] == '1');
+                }
+            } else if (c[0] == "RUN" && c.size() > 1) {
+                duration = std::stod(c[1]);
+                run_time = ir.run_time_inclusive ? (long long)duration
+                                                 : (long long)duration - 1;
+                for (t = 0; t <= run_time; t++) {
+                    process_timestep(ir, now + t);
+                }
+                if (run_time >= 0) {
+                    now += run_time + 1;
+                }
+
+                for (j = 0; j < ir.num_neurons(); j++) {
+                    if (ir.neurons[j].leak) {
+                        charge[j] = 0;
+                    }
+                    if (charge[j] < ir.min_potential) {
+                        charge[j] = ir.min_potential;
+                    }
+                }
+            } else if (c[0] == "CA" || c[0] == "CLEAR-A") {
+                charge.assign(ir.num_neurons(), 0);
+                events.clear();
+                to_fire.clear();
+            }
+        }
+    } catch (std::logic_error &e) {
+        throw "Error reading profile stimulus command " +
+            std::to_string(i + 1) + ": " + e.what();
+    }
+}
+
+void NetworkProfile::apply_spike(const NetworkIR &ir, uint32_t node_id,
+                                 long long time, double value) {
+    std::unordered_map<uint32_t, unsigned int>::const_iterator it;
+    Event e;
+
+    if (time < 0) {
+        return;
+    }
+
+    it = input_neurons.find(node_id);
+    if (it == input_neurons.end()) {
+        throw "Profile stimulus spikes node " + std::to_string(node_id) +
+            ", which is not an input neuron";
+    }
+
+    e.neuron = it->second;
+    e.value = value * ir.spike_value_factor;
+    events[now + time].push_back(e);
+    if (events[now + time].size() > peak_events) {
+        peak_events = events[now + time].size();
+    }
+}
+
+void NetworkProfile::process_timestep(const NetworkIR &ir, long long time) {
+    std::vector<Event> cur;
+    const IRSynapse *syn;
+    Event e;
+    unsigned int i;
+    unsigned int j;
+    unsigned int n;
+    bool fires;
+
+    fired.clear();
+    if (ir.fire_like_ravens) {
+        for (i = 0; i < to_fire.size(); i++) {
+            charge[to_fire[i]] = 0;
+            fired.push_back(to_fire[i]);
+        }
+        to_fire.clear();
+    }
+
+    cur.swap(events[time]);
+    events.erase(time);
+
+    for (i = 0; i < cur.size(); i++) {
+        n = cur[i].neuron;
+        if (ir.neurons[n].leak) {
+            charge[n] = 0;
+        }
+        if (charge[n] < ir.min_potential) {
+            charge[n] = ir.min_potential;
+        }
+    }
+
+    for (i = 0; i < cur.size(); i++) {
+        charge[cur[i].neuron] += cur[i].value;
+        check[cur[i].neuron] = true;
+    }
+
+    for (i = 0; i < cur.size(); i++) {
+        n = cur[i].neuron;
+        if (!check[n]) {
+            continue;
+        }
+        check[n] = false;
+
+        if (ir.threshold_inclusive) {
+            fires = (charge[n] >= ir.neurons[n].threshold);
+        } else {
+            fires = (charge[n] > ir.neurons[n].threshold);
+        }
+        if (!fires) {
+            continue;
+        }
+
+        for (j = 0; j < ir.neurons[n].synapses.size(); j++) {
+            syn = &ir.neurons[n].synapses[j];
+            e.neuron = syn->to;
+            e.value = syn->weight;
+            events[time + syn->delay].push_back(e);
+            if (events[time + syn->delay].size() > peak_events) {
+                peak_events = events[time + syn->delay].size();
+            }
+        }
+
+        if (ir.fire_like_ravens) {
+            to_fire.push_back(n);
+        } else {
+            charge[n] = 0;
+            fired.push_back(n);
+        }
+    }
+
+    record_fires();
+}
+
+void NetworkProfile::record_fires() {
+    unsigned int i;
+    unsigned int j;
+    unsigned int a;
+    unsigned int b;
+
+    for (i = 0; i < fired.size(); i++) {
+        fire_counts[fired[i]]++;
+    }
+
+    for (i = 0; i < fired.size() && i < MAX_CO_FIRE_NEURONS; i++) {
+        for (j = i + 1; j < fired.size() && j < MAX_CO_FIRE_NEURONS; j++) {
+            a = std::min(fired[i], fired[j]);
+            b = std::max(fired[i], fired[j]);
+            co_fires[std::make_pair(a, b)]++;
+        }
+    }
+}
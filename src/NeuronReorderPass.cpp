@@ -0,0 +1,94 @@
+#include "Passes.hpp"
+#include <algorithm>
+#include <deque>
+
+std::string NeuronReorderPass::name() const { return "reorder"; }
+
+/* Cuthill-McKee is a breadth-first search over the undirected synapse graph
+ * that visits the neighbors of each neuron in order of increasing degree.
+ * The search is seeded with the input neurons, in input order, and every
+ * component no input reaches is seeded from its lowest-degree neuron. The
+ * final order is reversed, which keeps the bandwidth of Cuthill-McKee while
+ * tightening the profile. */
+bool NeuronReorderPass::run(NetworkIR &ir) {
+    std::vector<std::vector<unsigned int>> adj;
+    std::vector<unsigned int> input_ind_to_neuron_ind;
+    std::vector<unsigned int> new_to_old;
+    std::vector<unsigned int> neighbors;
+    std::vector<bool> visited;
+    std::deque<unsigned int> queue;
+    unsigned int n;
+    unsigned int i;
+    unsigned int j;
+    unsigned int v;
+    unsigned int seed;
+
+    n = ir.num_neurons();
+    adj.resize(n);
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < ir.neurons[i].synapses.size(); j++) {
+            v = ir.neurons[i].synapses[j].to;
+            if (v != i) {
+                adj[i].push_back(v);
+                adj[v].push_back(i);
+            }
+        }
+    }
+    for (i = 0; i < n; i++) {
+        std::sort(adj[i].begin(), adj[i].end());
+        adj[i].erase(std::unique(adj[i].begin(), adj[i].end()), adj[i].end());
+    }
+
+    visited.assign(n, false);
+    input_ind_to_neuron_ind = ir.input_ind_to_neuron_ind();
+    for (i = 0; i < input_ind_to_neuron_ind.size(); i++) {
+        if (!visited[input_ind_to_neuron_ind[i]]) {
+            visited[input_ind_to_neuron_ind[i]] = true;
+            queue.push_back(input_ind_to_neuron_ind[i]);
+        }
+    }
+
+    while (new_to_old.size() < n) {
+        if (queue.empty()) {
+            seed = n;
+            for (i = 0; i < n; i++) {
+                if (!visited[i] &&
+                    (seed == n || adj[i].size() < adj[seed].size())) {
+                    seed = i;
+                }
+            }
+            visited[seed] = true;
+            queue.push_back(seed);
+        }
+
+        while (!queue.empty()) {
+            v = queue.front();
+            queue.pop_front();
+            new_to_old.push_back(v);
+
+            neighbors.clear();
+            for (j = 0; j < adj[v].size(); j++) {
+                if (!visited[adj[v][j]]) {
+                    visited[adj[v][j]] = true;
+                    neighbors.push_back(adj[v][j]);
+                }
+            }
+            std::stable_sort(neighbors.begin(), neighbors.end(),
+                             [&adj](unsigned int a, unsigned int b) {
+                                 return adj[a].size() < adj[b].size();
+                             });
+            queue.insert(queue.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+
+    std::reverse(new_to_old.begin(), new_to_old.end());
+
+    for (i = 0; i < n; i++) {
+        if (new_to_old[i] != i) {
+            ir.reorder_neurons(new_to_old);
+            return true;
+        }
+    }
+
+    return false;
+}
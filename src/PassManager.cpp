@@ -0,0 +1,117 @@
+#include "PassManager.hpp"
+#include "Passes.hpp"
+#include <sstream>
+
+PassManager::PassManager() { profile = nullptr; }
+
+PassManager::~PassManager() {
+    unsigned int i;
+
+    for (i = 0; i < passes.size(); i++) {
+        delete passes[i];
+    }
+}
+
+std::vector<std::string> PassManager::available_passes() {
+    std::vector<std::string> names;
+
+    names.push_back("verify");
+    names.push_back("dce");
+    names.push_back("simplify");
+    names.push_back("reorder");
+    names.push_back("delay-sort");
+    names.push_back("profile-order");
+
+    return names;
+}
+
+Pass *PassManager::create_pass(const std::string &name) {
+    if (name == "verify") {
+        return new VerifyPass();
+    }
+    if (name == "dce") {
+        return new DeadNeuronEliminationPass();
+    }
+    if (name == "simplify") {
+        return new GraphSimplificationPass();
+    }
+    if (name == "reorder") {
+        return new NeuronReorderPass();
+    }
+    if (name == "delay-sort") {
+        return new DelaySortPass();
+    }
+    if (name == "profile-order") {
+        if (profile == nullptr) {
+            throw(std::string) "The profile-order pass needs a --profile "
+                               "stimulus file";
+        }
+        return new ProfileOrderPass(profile);
+    }
+
+    return nullptr;
+}
+
+/* Must be called before passes are added for profile-guided passes to be
+ * available */
+void PassManager::set_profile(NetworkProfile *_profile) { profile = _profile; }
+
+void PassManager::add_pass(const std::string &name) {
+    std::vector<std::string> names;
+    std::string msg;
+    Pass *p;
+    unsigned int i;
+
+    p = create_pass(name);
+    if (p == nullptr) {
+        names = available_passes();
+        msg = "Unknown pass \"" + name + "\". Available passes:";
+        for (i = 0; i < names.size(); i++) {
+            msg += " " + names[i];
+        }
+        throw msg;
+    }
+
+    passes.push_back(p);
+}
+
+/* Add a comma-separated list of passes, in order */
+void PassManager::add_passes(const std::string &names) {
+    std::stringstream ss(names);
+    std::string name;
+
+    while (std::getline(ss, name, ',')) {
+        if (name != "") {
+            add_pass(name);
+        }
+    }
+}
+
+/* Add the default pipeline for an -O level. Level 0 runs no passes. */
+void PassManager::add_optimization_level(int level) {
+    if (level < 0) {
+        throw(std::string) "Optimization level must not be negative";
+    }
+
+    if (level >= 1) {
+        add_pass("dce");
+        add_pass("simplify");
+        add_pass("dce");
+        add_pass("delay-sort");
+    }
+
+    if (level >= 2) {
+        add_pass("reorder");
+        if (profile != nullptr) {
+            add_pass("profile-order");
+        }
+    }
+}
+
+void PassManager::run(NetworkIR &ir) {
+    unsigned int i;
+
+    for (i = 0; i < passes.size(); i++) {
+        passes[i]->run(ir);
+    }
+}
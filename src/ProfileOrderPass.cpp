@@ -0,0 +1,88 @@
+#include "Passes.hpp"
+#include <algorithm>
+
+ProfileOrderPass::ProfileOrderPass(NetworkProfile *_profile) {
+    profile = _profile;
+}
+
+std::string ProfileOrderPass::name() const { return "profile-order"; }
+
+/* Greedy chaining: start from the hottest unplaced neuron, then keep
+ * appending the unplaced neuron that co-fired most often with the last one
+ * placed. When the chain runs out of co-firing partners, start a new chain
+ * from the next hottest neuron. */
+bool ProfileOrderPass::run(NetworkIR &ir) {
+    std::vector<std::vector<std::pair<unsigned int, unsigned long>>> co;
+    std::map<std::pair<unsigned int, unsigned int>, unsigned long>::iterator it;
+    std::vector<unsigned int> by_heat;
+    std::vector<unsigned int> new_to_old;
+    std::vector<bool> placed;
+    std::vector<unsigned long> &fires = profile->fire_counts;
+    unsigned int n;
+    unsigned int i;
+    unsigned int j;
+    unsigned int v;
+    unsigned int best;
+    unsigned long best_count;
+
+    profile->run(ir);
+
+    n = ir.num_neurons();
+    co.resize(n);
+    for (it = profile->co_fires.begin(); it != profile->co_fires.end(); it++) {
+        co[it->first.first].push_back(
+            std::make_pair(it->first.second, it->second));
+        co[it->first.second].push_back(
+            std::make_pair(it->first.first, it->second));
+    }
+
+    for (i = 0; i < n; i++) {
+        if (fires[i] > 0) {
+            by_heat.push_back(i);
+        }
+    }
+    std::stable_sort(by_heat.begin(), by_heat.end(),
+                     [&fires](unsigned int a, unsigned int b) {
+                         return fires[a] > fires[b];
+                     });
+
+    placed.assign(n, false);
+    for (i = 0; i < by_heat.size(); i++) {
+        v = by_heat[i];
+        while (!placed[v]) {
+            placed[v] = true;
+            new_to_old.push_back(v);
+
+            best = n;
+            best_count = 0;
+            for (j = 0; j < co[v].size(); j++) {
+                if (!placed[co[v][j].first] &&
+                    (co[v][j].second > best_count ||
+                     (co[v][j].second == best_count &&
+                      fires[co[v][j].first] > fires[best]))) {
+                    best = co[v][j].first;
+                    best_count = co[v][j].second;
+                }
+            }
+            if (best == n) {
+                break;
+            }
+            v = best;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (!placed[i]) {
+            new_to_old.push_back(i);
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (new_to_old[i] != i) {
+            ir.reorder_neurons(new_to_old);
+            return true;
+        }
+    }
+
+    return false;
+}
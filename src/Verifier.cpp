@@ -0,0 +1,338 @@
+#include "Verifier.hpp"
+#include "risp.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+typedef void (*Apply_Spike_Fn)(unsigned int, double);
+typedef void (*Void_Fn)();
+typedef unsigned int (*Output_Count_Fn)(unsigned int);
+typedef double (*Output_Last_Fire_Fn)(unsigned int);
+
+/* Unmangled entry points appended to the generated code, which is compiled
+ * as C++ */
+static const char *VERIFY_ENTRY_POINTS =
+    "\n"
+    "extern \"C\" void verify_apply_spike(unsigned int input_ind, "
+    "double value) {\n"
+    "    apply_spike(input_ind, 0, value);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" void verify_run() {\n"
+    "    run(VERIFY_STEP);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" void verify_clear_activity() {\n"
+    "    clear_activity();\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int verify_output_count(unsigned int output_ind) "
+    "{\n"
+    "    return output_count(output_ind);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" double verify_output_last_fire(unsigned int output_ind) {\n"
+    "    return output_last_fire(output_ind);\n"
+    "}\n";
+
+Verifier::Verifier() {
+    const char *cxx;
+
+    timesteps = 1000;
+    spike_rate = 0.1;
+    seed = 0;
+    cxx = getenv("CXX");
+    compiler = (cxx != NULL && cxx[0] != '\0') ? cxx : "c++";
+    checked_timesteps = 0;
+    reference_seconds = 0;
+    generated_seconds = 0;
+    loaded = false;
+}
+
+void Verifier::load(const std::string &path) {
+    std::ifstream fin(path);
+    std::string line;
+    std::string token;
+    std::vector<std::string> tokens;
+
+    if (!fin.is_open()) {
+        throw "Cannot open verify stimulus file " + path;
+    }
+
+    commands.clear();
+    while (std::getline(fin, line)) {
+        std::stringstream ss(line);
+
+        tokens.clear();
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+        if (!tokens.empty()) {
+            commands.push_back(tokens);
+        }
+    }
+    loaded = true;
+}
+
+/* Flattens the stimulus into the spikes that land in each timestep, so both
+ * simulators only ever see spikes for the timestep about to run. CA drops
+ * the spikes still pending at that point, as clear_activity() does. */
+void Verifier::build_schedule(neuro::Network *net, bool run_time_inclusive) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    neuro::Node *node;
+    unsigned long now;
+    unsigned long t;
+    unsigned int i;
+    unsigned int j;
+    long long time;
+
+    schedule.clear();
+
+    if (!loaded) {
+        schedule.resize(timesteps);
+        for (t = 0; t < timesteps; t++) {
+            for (j = 0; j < net->num_inputs(); j++) {
+                if (uniform(rng) < spike_rate) {
+                    schedule[t].spikes.push_back(std::make_pair(j, 1.0));
+                }
+            }
+        }
+        return;
+    }
+
+    now = 0;
+    try {
+        for (i = 0; i < commands.size(); i++) {
+            const std::vector<std::string> &c = commands[i];
+
+            if (c[0] == "AS") {
+                for (j = 1; j + 2 < c.size(); j += 3) {
+                    time = std::stoll(c[j + 1]);
+                    if (!net->is_node(std::stoul(c[j])) ||
+                        !net->get_node(std::stoul(c[j]))->is_input()) {
+                        throw "Verify stimulus spikes node " + c[j] +
+                            ", which is not an input neuron";
+                    }
+                    if (time < 0) {
+                        continue;
+                    }
+                    node = net->get_node(std::stoul(c[j]));
+                    if (schedule.size() <= now + time) {
+                        schedule.resize(now + time + 1);
+                    }
+                    schedule[now + time].spikes.push_back(
+                        std::make_pair(node->input_id, std::stod(c[j + 2])));
+                }
+            } else if (c[0] == "ASR" && c.size() > 2) {
+                if (!net->is_node(std::stoul(c[1])) ||
+                    !net->get_node(std::stoul(c[1]))->is_input()) {
+                    throw "Verify stimulus spikes node " + c[1] +
+                        ", which is not an input neuron";
+                }
+                node = net->get_node(std::stoul(c[1]));
+                for (j = 0; j < c[2].size(); j++) {
+                    if (c[2][j] != '1') {
+                        continue;
+                    }
+                    if (schedule.size() <= now + j) {
+                        schedule.resize(now + j + 1);
+                    }
+                    schedule[now + j].spikes.push_back(
+                        std::make_pair(node->input_id, 1.0));
+                }
+            } else if (c[0] == "RUN" && c.size() > 1) {
+                now += std::stoul(c[1]) + (run_time_inclusive ? 1 : 0);
+            } else if (c[0] == "CA" || c[0] == "CLEAR-A") {
+                schedule.resize(now + 1);
+                schedule[now].spikes.clear();
+                schedule[now].clear = true;
+            }
+        }
+    } catch (std::logic_error &e) {
+        throw "Error reading verify stimulus command " +
+            std::to_string(i + 1) + ": " + e.what();
+    }
+
+    schedule.resize(now);
+}
+
+void Verifier::run(neuro::Network *net, nlohmann::json &params,
+                   const std::string &code) {
+    risp::Processor reference(params);
+    Apply_Spike_Fn gen_apply_spike;
+    Void_Fn gen_run;
+    Void_Fn gen_clear_activity;
+    Output_Count_Fn gen_output_count;
+    Output_Last_Fire_Fn gen_output_last_fire;
+    std::chrono::steady_clock::time_point start;
+    std::ofstream fout;
+    std::string command;
+    std::string error;
+    char dir[] = "/tmp/framework_embedder_verify_XXXXXX";
+    void *handle;
+    bool run_time_inclusive;
+    int step;
+    unsigned long t;
+    unsigned int i;
+    unsigned int gen_count;
+    int ref_count;
+    double gen_last_fire;
+    double ref_last_fire;
+
+    run_time_inclusive = params.contains("run_time_inclusive") &&
+                         params["run_time_inclusive"].get<bool>();
+    step = run_time_inclusive ? 0 : 1;
+    build_schedule(net, run_time_inclusive);
+    reference.load_network(net);
+
+    // Compile the generated code into a shared object and load it
+    if (mkdtemp(dir) == NULL) {
+        throw(std::string) "Cannot create a directory to compile the "
+                           "generated code in";
+    }
+    fout.open(std::string(dir) + "/generated.cpp");
+    fout << code << "\n#define VERIFY_STEP " << step << "\n"
+         << VERIFY_ENTRY_POINTS;
+    fout.close();
+
+    command = compiler + " -O2 -w -shared -fPIC -o " + dir +
+              "/generated.so " + dir + "/generated.cpp";
+    if (system(command.c_str()) != 0) {
+        error = "Compiling the generated code failed: " + command;
+    }
+
+    handle = NULL;
+    if (error.empty()) {
+        handle = dlopen((std::string(dir) + "/generated.so").c_str(),
+                        RTLD_NOW | RTLD_LOCAL);
+        if (handle == NULL) {
+            error = std::string("Cannot load the generated code: ") +
+                    dlerror();
+        }
+    }
+
+    unlink((std::string(dir) + "/generated.cpp").c_str());
+    unlink((std::string(dir) + "/generated.so").c_str());
+    rmdir(dir);
+    if (!error.empty()) {
+        throw error;
+    }
+
+    gen_apply_spike = (Apply_Spike_Fn)dlsym(handle, "verify_apply_spike");
+    gen_run = (Void_Fn)dlsym(handle, "verify_run");
+    gen_clear_activity = (Void_Fn)dlsym(handle, "verify_clear_activity");
+    gen_output_count = (Output_Count_Fn)dlsym(handle, "verify_output_count");
+    gen_output_last_fire =
+        (Output_Last_Fire_Fn)dlsym(handle, "verify_output_last_fire");
+    if (gen_apply_spike == NULL || gen_run == NULL ||
+        gen_clear_activity == NULL || gen_output_count == NULL ||
+        gen_output_last_fire == NULL) {
+        dlclose(handle);
+        throw(std::string) "The generated code is missing its entry points";
+    }
+
+    // Run both in lockstep and stop at the first difference
+    mismatch = "";
+    checked_timesteps = 0;
+    for (t = 0; t < schedule.size() && mismatch.empty(); t++) {
+        if (schedule[t].clear) {
+            gen_clear_activity();
+            reference.clear_activity();
+        }
+        for (i = 0; i < schedule[t].spikes.size(); i++) {
+            gen_apply_spike(schedule[t].spikes[i].first,
+                            schedule[t].spikes[i].second);
+            reference.apply_spike(neuro::Spike(schedule[t].spikes[i].first,
+                                               0,
+                                               schedule[t].spikes[i].second));
+        }
+        gen_run();
+        reference.run(step);
+
+        for (i = 0; i < net->num_outputs(); i++) {
+            gen_count = gen_output_count(i);
+            gen_last_fire = gen_output_last_fire(i);
+            ref_count = reference.output_count(i);
+            ref_last_fire = reference.output_last_fire(i);
+            if ((int)gen_count != ref_count ||
+                gen_last_fire != ref_last_fire) {
+                mismatch = "timestep " + std::to_string(t) + ", output " +
+                           std::to_string(net->output(i)->id) +
+                           ": generated code fired " +
+                           std::to_string(gen_count) + " times (last " +
+                           std::to_string((long long)gen_last_fire) +
+                           "), risp::Processor fired " +
+                           std::to_string(ref_count) + " times (last " +
+                           std::to_string((long long)ref_last_fire) + ")";
+                break;
+            }
+        }
+        checked_timesteps++;
+    }
+
+    // Time each simulator alone on the whole stimulus
+    reference_seconds = 0;
+    generated_seconds = 0;
+    if (mismatch.empty()) {
+        gen_clear_activity();
+        start = std::chrono::steady_clock::now();
+        for (t = 0; t < schedule.size(); t++) {
+            if (schedule[t].clear) {
+                gen_clear_activity();
+            }
+            for (i = 0; i < schedule[t].spikes.size(); i++) {
+                gen_apply_spike(schedule[t].spikes[i].first,
+                                schedule[t].spikes[i].second);
+            }
+            gen_run();
+        }
+        generated_seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+        reference.clear_activity();
+        start = std::chrono::steady_clock::now();
+        for (t = 0; t < schedule.size(); t++) {
+            if (schedule[t].clear) {
+                reference.clear_activity();
+            }
+            for (i = 0; i < schedule[t].spikes.size(); i++) {
+                reference.apply_spike(
+                    neuro::Spike(schedule[t].spikes[i].first, 0,
+                                 schedule[t].spikes[i].second));
+            }
+            reference.run(step);
+        }
+        reference_seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    }
+
+    dlclose(handle);
+}
+
+std::string Verifier::report() const {
+    char buf[160];
+
+    if (!mismatch.empty()) {
+        return "Verify: MISMATCH at " + mismatch;
+    }
+
+    snprintf(buf, sizeof(buf),
+             "Verify: generated code matches risp::Processor for %lu "
+             "timesteps, %.1fx faster (%.1f vs %.1f ns per timestep)",
+             checked_timesteps,
+             generated_seconds > 0 ? reference_seconds / generated_seconds
+                                   : 0.0,
+             generated_seconds * 1e9 / std::max(checked_timesteps, 1UL),
+             reference_seconds * 1e9 / std::max(checked_timesteps, 1UL));
+
+    return buf;
+}
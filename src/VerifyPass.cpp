@@ -0,0 +1,9 @@
+#include "Passes.hpp"
+
+std::string VerifyPass::name() const { return "verify"; }
+
+bool VerifyPass::run(NetworkIR &ir) {
+    ir.verify();
+
+    return false;
+}
@@ -1,27 +1,368 @@
 #include "EmbeddedRisp.hpp"
+#include "EmbeddedRispBinary.hpp"
+#include "EmbeddedRispHybrid.hpp"
 #include "EmbeddedRispSoA.hpp"
+#include "EmbeddedRispStatic.hpp"
+#include "PassManager.hpp"
+#include "Verifier.hpp"
 #include "helpers.hpp"
 #include "utils/cmdline.h"
 #include "utils/json_helpers.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <dirent.h>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
-int main(int argc, char **argv) {
-    std::string line;
-    std::string j_str;
-    std::string proc_name;
+/* One network of a --batch run */
+struct Batch_Job {
+    std::string name;   /* Output file name without .c */
+    std::string source; /* Network JSON, or the path of a file holding it */
+};
+
+/* Adds the IR passes selected on the command line */
+static void add_passes(PassManager &pass_manager,
+                       const cmdline::parser &parse) {
+    if (parse.exist("passes")) {
+        pass_manager.add_passes(parse.get<string>("passes"));
+    } else {
+        pass_manager.add_optimization_level(parse.get<int>("optimize"));
+    }
+}
+
+/* Generates code for one network and writes it to out, then checks it with
+ * --verify. Reports go to log. Returns false if the check fails. Everything
+ * is local, so networks can be embedded on several threads at once. */
+static bool embed_network(nlohmann::json j, const cmdline::parser &parse,
+                          const NetworkProfile *loaded_profile,
+                          const Verifier &loaded_verifier, std::ostream &out,
+                          std::ostream &log) {
     std::string desired_processor;
     std::vector<std::string> net_data_keys;
     IndentString out_s;
-    nlohmann::json j;
     neuro::Network net;
-    EmbeddedRisp *emb_risp;
-    EmbeddedRispSoA *emb_risp_soa;
-    neuro::EdgeMap::iterator edge_it;
-    cmdline::parser parse;
-    double node_delay;
+    EmbeddedRispBase *emb;
+    EmbeddedRispSoA *soa;
+    EmbeddedRisp *sparse;
+    PassManager pass_manager;
+    NetworkProfile profile;
+    Verifier verifier;
+    nlohmann::json proc_params;
+    std::string code;
+    double profile_margin;
     int sim_time;
     int max_num_timesteps;
 
+    desired_processor = parse.get<string>("processor");
+    profile_margin = parse.get<double>("profile-margin");
+    verifier = loaded_verifier;
+    if (loaded_profile != NULL) {
+        profile = *loaded_profile;
+        pass_manager.set_profile(&profile);
+    }
+    add_passes(pass_manager, parse);
+
+    // Load json into corresponding TENNLab object via trial and error
+    try {
+        net.from_json(j);
+    } catch (std::runtime_error &e) {
+        throw(std::string) "Provided json cannot be parsed into a "
+                            "network";
+    }
+
+    // Extract sim_time from network json if existant
+    sim_time = -1;
+    net_data_keys = net.data_keys();
+    if (std::find(net_data_keys.begin(), net_data_keys.end(),
+                    "other") != net_data_keys.end()) {
+        try {
+            j = net.get_data("other");
+            if (j.contains("sim_time")) {
+                sim_time = j["sim_time"].get<int>();
+            }
+        } catch (...) {
+            throw(std::string) "Error reading sim_time from the given "
+                                "network JSON's other associated data.";
+        }
+    }
+
+    out_s = "";
+
+    // Generate spiking neural network code for neuroprocessor
+
+    // Extract processor parameters from network JSON
+    try {
+        j = net.get_data("proc_params");
+    } catch (...) {
+        throw(std::string) "Error reading proc_params from the given "
+                            "network JSON's associated data.";
+    }
+
+    proc_params = j;
+
+    // Create risp processor object and load the given network
+    if (desired_processor == "rispSoA") {
+        soa = new EmbeddedRispSoA(j);
+        soa->spmv_propagation =
+            parse.get<string>("soa-propagation") == "spmv";
+        emb = soa;
+    } else if (desired_processor == "rispHybrid") {
+        emb = new EmbeddedRispHybrid(j);
+    } else {
+        if (desired_processor == "rispStatic") {
+            sparse = new EmbeddedRispStatic(j);
+        } else if (desired_processor == "rispBinary") {
+            sparse = new EmbeddedRispBinary(j);
+        } else {
+            sparse = new EmbeddedRisp(j);
+        }
+        sparse->compress_synapses = parse.exist("compress-synapses");
+        emb = sparse;
+    }
+
+    // A backend that rejects the network throws, so free it on the way out
+    try {
+        emb->real_type = parse.get<string>("real-type");
+        emb->spike_queue_size = parse.get<int>("spike-queue");
+        emb->output_callback = parse.exist("output-callback");
+        emb->run_until = parse.exist("run-until");
+        emb->wcet = parse.exist("wcet");
+        emb->tick = parse.exist("tick");
+        emb->load_network(&net);
+
+        // Optimize the network IR that code is generated from
+        pass_manager.run(*emb->ir);
+
+        // Size the per-timestep event arrays from the profiled peak
+        if (loaded_profile != NULL) {
+            profile.run(*emb->ir);
+            emb->max_events_per_timestep =
+                (unsigned int)std::ceil(profile.peak_events *
+                                        (1 + profile_margin));
+            if (emb->max_events_per_timestep == 0) {
+                emb->max_events_per_timestep = 1;
+            }
+        }
+
+        // Report how much precision the weights and thresholds lose
+        emb->compute_real_format();
+        if (emb->real_type != "double") {
+            log << emb->quantization_report() << std::endl;
+        }
+
+        // Report the worst-case work of a timestep
+        if (emb->wcet) {
+            log << emb->wcet_report() << std::endl;
+        }
+
+        // Determine the maximum number of timesteps to track in static C
+        // code for the given network (either sim_time or maximum synapse
+        // delay + 1)
+        max_num_timesteps = -1;
+        if (sim_time > 0) {
+            max_num_timesteps = sim_time;
+        }
+        if ((int)emb->ir->max_delay() + 1 > max_num_timesteps) {
+            max_num_timesteps = emb->ir->max_delay() + 1;
+        }
+        if (max_num_timesteps < 2) {
+            max_num_timesteps = 2;
+        }
+
+        // Write out neuroprocessor static C code
+        code = emb->gen_static_c(max_num_timesteps);
+        out_s += code + "\n\n";
+    } catch (...) {
+        delete emb;
+        throw;
+    }
+
+    delete emb;
+
+    out << out_s.get_str();
+
+    // Check the code against the framework's own simulator
+    if (parse.exist("verify")) {
+        out.flush();
+        verifier.run(&net, proc_params, code);
+        log << verifier.report() << std::endl;
+        return verifier.mismatch.empty();
+    }
+
+    return true;
+}
+
+/* Returns a file name without its directories and extension */
+static std::string base_name(const std::string &path) {
+    std::string name;
+
+    name = path.substr(path.find_last_of('/') + 1);
+    if (name.find('.') != std::string::npos && name.find('.') != 0) {
+        name = name.substr(0, name.rfind('.'));
+    }
+    return name;
+}
+
+/* Collects the networks of --batch: every .json file of a directory, a file
+ * of JSON lines with one network per line ("-" reads them from standard
+ * input), or a file listing one network JSON path per line */
+static std::vector<Batch_Job> batch_jobs(const std::string &path) {
+    std::vector<Batch_Job> jobs;
+    std::vector<std::string> lines;
+    std::ifstream fin;
+    std::string line;
+    std::string name;
+    struct dirent *ent;
+    DIR *dir;
+    size_t i;
+    bool json_lines;
+
+    // A directory of network files
+    dir = opendir(path.c_str());
+    if (dir != NULL) {
+        while ((ent = readdir(dir)) != NULL) {
+            name = ent->d_name;
+            if (name.size() > 5 && name.substr(name.size() - 5) == ".json") {
+                jobs.push_back(Batch_Job{base_name(name), path + "/" + name});
+            }
+        }
+        closedir(dir);
+        std::sort(jobs.begin(), jobs.end(),
+                  [](const Batch_Job &a, const Batch_Job &b) {
+                      return a.name < b.name;
+                  });
+        return jobs;
+    }
+
+    if (path != "-") {
+        fin.open(path);
+        if (!fin.is_open()) {
+            throw(std::string) "Cannot open --batch " + path;
+        }
+    }
+    while (std::getline(path == "-" ? std::cin : fin, line)) {
+        if (line.find_first_not_of(" \t\r") != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+
+    // JSON lines are named by their position, listed files by their name
+    json_lines = path == "-" ||
+                 (!lines.empty() &&
+                  lines[0][lines[0].find_first_not_of(" \t")] == '{');
+    for (i = 0; i < lines.size(); i++) {
+        if (json_lines) {
+            jobs.push_back(Batch_Job{"network_" + std::to_string(i), lines[i]});
+        } else {
+            jobs.push_back(Batch_Job{base_name(lines[i]), lines[i]});
+        }
+    }
+
+    return jobs;
+}
+
+/* Embeds every network of --batch into its own .c file in --batch-output on
+ * a pool of --jobs threads. Reports are prefixed with the network's name.
+ * Returns the number of networks that failed. */
+static unsigned int run_batch(const cmdline::parser &parse,
+                              const NetworkProfile *profile,
+                              const Verifier &verifier) {
+    std::vector<Batch_Job> jobs;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next(0);
+    std::atomic<unsigned int> failures(0);
+    std::mutex log_lock;
+    std::string dir;
+    unsigned int num_threads;
+    unsigned int t;
+
+    jobs = batch_jobs(parse.get<string>("batch"));
+    dir = parse.get<string>("batch-output");
+    num_threads = parse.get<int>("jobs");
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (t = 0; t < num_threads && t < jobs.size(); t++) {
+        workers.push_back(std::thread([&]() {
+            std::string path;
+            std::string line;
+            size_t k;
+            bool ok;
+            bool written;
+
+            while ((k = next++) < jobs.size()) {
+                std::ostringstream log;
+                std::ofstream out;
+
+                path = dir + "/" + jobs[k].name + ".c";
+                ok = false;
+                written = false;
+                try {
+                    out.open(path);
+                    if (!out.is_open()) {
+                        throw(std::string) "Cannot open " + path +
+                            " for writing";
+                    }
+                    ok = embed_network(json_from_string_or_file(
+                                           jobs[k].source),
+                                       parse, profile, verifier, out, log);
+                    written = true;
+                } catch (const json::exception &e) {
+                    log << e.what() << std::endl;
+                } catch (std::runtime_error &e) {
+                    log << e.what() << std::endl;
+                } catch (const std::string &e) {
+                    log << e << std::endl;
+                }
+                out.close();
+
+                // Leave no partial code behind
+                if (!written) {
+                    remove(path.c_str());
+                }
+                if (!ok) {
+                    failures++;
+                }
+
+                std::lock_guard<std::mutex> lock(log_lock);
+                std::istringstream lines(log.str());
+                while (std::getline(lines, line)) {
+                    std::cerr << jobs[k].name << ": " << line << std::endl;
+                }
+            }
+        }));
+    }
+    for (t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    std::cerr << "Generated " << jobs.size() - failures << " of "
+              << jobs.size() << " networks into " << dir << std::endl;
+
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    std::string line;
+    std::string j_str;
+    std::string desired_processor;
+    nlohmann::json j;
+    std::vector<std::string> args;
+    PassManager pass_manager;
+    NetworkProfile profile;
+    Verifier verifier;
+    double profile_margin;
+    cmdline::parser parse;
+    unsigned int failures;
+    int i;
+    bool verified;
+
+    verified = true;
     try {
 
         // Load in command line arguments from user
@@ -29,18 +370,141 @@ int main(int argc, char **argv) {
             parse.add<string>(
                 "processor", 'p',
                 "which processor you'd like code to be generated for, "
-                "<risp|rispSoA>",
-                false, "risp", cmdline::oneof<string>("risp", "rispSoA"));
+                "<risp|rispSoA|rispHybrid|rispStatic|rispBinary>",
+                false, "risp",
+                cmdline::oneof<string>("risp", "rispSoA", "rispHybrid",
+                                       "rispStatic", "rispBinary"));
 
-            parse.parse_check(argc, argv);
+            parse.add<int>("optimize", 'O',
+                           "optimization level for the network IR pass "
+                           "pipeline, <0|1|2>",
+                           false, 1, cmdline::range(0, 2));
+            parse.add<string>("passes", '\0',
+                              "comma-separated list of IR passes to run "
+                              "instead of the -O pipeline",
+                              false, "");
+            parse.add<string>("profile", '\0',
+                              "processor_tool stimulus file to profile the "
+                              "network with",
+                              false, "");
+            parse.add<double>("profile-margin", '\0',
+                              "safety margin added to the profiled peak "
+                              "number of events per timestep, as a fraction",
+                              false, 0.25);
+            parse.add<string>("soa-propagation", '\0',
+                              "how rispSoA delivers fires to their targets, "
+                              "<scatter|spmv>",
+                              false, "scatter",
+                              cmdline::oneof<string>("scatter", "spmv"));
+            parse.add<string>("real-type", '\0',
+                              "arithmetic type of charges, weights and "
+                              "thresholds, <double|float|q15|q31>",
+                              false, "double",
+                              cmdline::oneof<string>("double", "float", "q15",
+                                                     "q31"));
+            parse.add("compress-synapses", '\0',
+                      "emit packed read-only synapse tables with a weight "
+                      "palette (sparse RISP only)");
+            parse.add<int>("spike-queue", '\0',
+                           "capacity of a lock-free enqueue_spike() input "
+                           "queue drained by run(), 0 for none",
+                           false, 0);
+            parse.add("output-callback", '\0',
+                      "emit set_output_callback() and call the callback for "
+                      "every output fire during run()");
+            parse.add("run-until", '\0',
+                      "emit run_until(), which stops early once an output "
+                      "fires, an output reaches a fire count or the network "
+                      "goes quiescent");
+            parse.add("wcet", '\0',
+                      "emit worst-case per-timestep operation counts as "
+                      "WCET_* defines and report them on standard error");
+            parse.add("tick", '\0',
+                      "emit a tick() driver that runs one timestep between "
+                      "double-buffered input and output frames and counts "
+                      "deadline misses");
+            parse.add("verify", '\0',
+                      "compile the generated code, check it against "
+                      "risp::Processor timestep by timestep and report the "
+                      "speedup on standard error");
+            parse.add<string>("verify-stimulus", '\0',
+                              "processor_tool stimulus file for --verify "
+                              "instead of random input spikes",
+                              false, "");
+            parse.add<unsigned long>("verify-timesteps", '\0',
+                                     "number of timesteps of random input "
+                                     "spikes for --verify",
+                                     false, 1000);
+            parse.add<string>("batch", '\0',
+                              "embed many networks at once: a directory of "
+                              ".json files, a file of network paths, or JSON "
+                              "lines with one network per line (- for "
+                              "stdin)",
+                              false, "");
+            parse.add<string>("batch-output", '\0',
+                              "directory to write the --batch .c files to",
+                              false, ".");
+            parse.add<int>("jobs", 'j',
+                           "number of threads for --batch, 0 for one per "
+                           "core",
+                           false, 0, cmdline::range(0, 1024));
+
+            // Accept the conventional -O<level> spelling as well as -O <level>
+            for (i = 0; i < argc; i++) {
+                args.push_back(argv[i]);
+                if (args.back().size() > 2 && args.back().substr(0, 2) == "-O") {
+                    args.push_back(args.back().substr(2));
+                    args[args.size() - 2] = "-O";
+                }
+            }
+            parse.parse_check(args);
 
             desired_processor = parse.get<string>("processor");
+            if (parse.exist("soa-propagation") &&
+                desired_processor != "rispSoA") {
+                throw(std::string) "--soa-propagation only applies to "
+                                   "-p rispSoA";
+            }
+            if (parse.exist("compress-synapses") &&
+                (desired_processor == "rispSoA" ||
+                 desired_processor == "rispHybrid")) {
+                throw(std::string) "--compress-synapses only applies to "
+                                   "sparse RISP code";
+            }
+
+            if (parse.get<int>("spike-queue") == 1 ||
+                parse.get<int>("spike-queue") < 0) {
+                throw(std::string) "--spike-queue must be 0 or at least 2";
+            }
+
+            profile_margin = parse.get<double>("profile-margin");
+            if (profile_margin < 0) {
+                throw(std::string) "--profile-margin must not be negative";
+            }
+            if (parse.exist("verify-stimulus")) {
+                verifier.load(parse.get<string>("verify-stimulus"));
+            }
+            verifier.timesteps = parse.get<unsigned long>("verify-timesteps");
+
+            if (parse.exist("profile")) {
+                profile.load(parse.get<string>("profile"));
+            }
+
+            // Check the pass names before reading any network
+            add_passes(pass_manager, parse);
 
         } catch (std::runtime_error &e) {
             std::cerr << "Error parsing command line arguments" << std::endl;
             throw e;
         }
 
+        if (parse.exist("batch")) {
+            failures = run_batch(parse,
+                                 parse.exist("profile") ? &profile : NULL,
+                                 verifier);
+            return failures == 0 ? 0 : 1;
+        }
+
         // Get json as a std::string from stdin (can also be a std::string
         // representing a file path to a json file)
         j_str = "";
@@ -61,88 +525,19 @@ int main(int argc, char **argv) {
             throw e;
         }
 
-        // Load json into corresponding TENNLab object via trial and error
-        try {
-            net.from_json(j);
-        } catch (std::runtime_error &e) {
-            throw(std::string) "Provided json cannot be parsed into a "
-                                "network";
-        }
-
-        // Extract sim_time from network json if existant
-        sim_time = -1;
-        net_data_keys = net.data_keys();
-        if (std::find(net_data_keys.begin(), net_data_keys.end(),
-                        "other") != net_data_keys.end()) {
-            try {
-                j = net.get_data("other");
-                if (j.contains("sim_time")) {
-                    sim_time = j["sim_time"].get<int>();
-                }
-            } catch (...) {
-                throw(std::string) "Error reading sim_time from the given "
-                                    "network JSON's other associated data.";
-            }
-        }
-
-        out_s = "";
-
-        // Generate spiking neural network code for neuroprocessor
-
-        // Extract processor parameters from network JSON
-        try {
-            j = net.get_data("proc_params");
-        } catch (...) {
-            throw(std::string) "Error reading proc_params from the given "
-                                "network JSON's associated data.";
-        }
-
-        // Create risp processor object and load the given network
-        if (desired_processor == "rispSoA") {
-            emb_risp_soa = new EmbeddedRispSoA(j);
-            emb_risp_soa->load_network(&net);
-        } else {
-            emb_risp = new EmbeddedRisp(j);
-            emb_risp->load_network(&net);
-        }
-
-        // Determine the maximum number of timesteps to track in static C
-        // code for the given network (either sim_time or maximum synapse
-        // delay + 1)
-        max_num_timesteps = -1;
-        if (sim_time > 0) {
-            max_num_timesteps = sim_time;
-        }
-        for (edge_it = net.edges_begin(); edge_it != net.edges_end();
-                edge_it++) {
-            node_delay = edge_it->second->get("Delay");
-            if (node_delay + 1 > max_num_timesteps) {
-                max_num_timesteps = node_delay + 1;
-            }
-        }
-        if (max_num_timesteps < 2) {
-            max_num_timesteps = 2;
-        }
-
-        if (desired_processor == "rispSoA") {
-            // Write out neuroprocessor static C code
-            out_s += emb_risp_soa->gen_static_c(max_num_timesteps) + "\n\n";
-
-            delete emb_risp_soa;
-        } else {
-            // Write out neuroprocessor static C code
-            out_s += emb_risp->gen_static_c(max_num_timesteps) + "\n\n";
-
-            delete emb_risp;
-        }
-
-        std::cout << out_s.get_str();
+        verified = embed_network(j, parse,
+                                 parse.exist("profile") ? &profile : NULL,
+                                 verifier, std::cout, std::cerr);
 
     } catch (const json::exception &e) {
         std::cerr << e.what() << std::endl;
+        verified = false;
     } catch (std::runtime_error &e) {
         std::cerr << e.what() << std::endl;
+        verified = false;
     } catch (const std::string &e) {
         std::cerr << e << std::endl;
+        verified = false;
     }
+    return verified ? 0 : 1;
 }
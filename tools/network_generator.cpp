@@ -0,0 +1,299 @@
+/* Generates a random RISP network in TENNLab JSON on stdout, and optionally
+ * a matching random processor_tool stimulus, for benchmarking the embedder
+ * and the generated simulators on networks far larger than those in
+ * testing/.
+ *
+ * Neurons are numbered 0..n-1 with the inputs first and the outputs last.
+ * Synapses go to a higher id unless they are picked as recurrent, in which
+ * case they go to any id up to and including their own, so a recurrence of 0
+ * gives a feed-forward network. */
+
+#include "utils/cmdline.h"
+#include "utils/json_helpers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+/* Returns a uniformly random value in [lo, hi], rounded for discrete
+ * networks */
+static double random_value(std::mt19937_64 &rng, double lo, double hi,
+                           bool discrete) {
+    if (discrete) {
+        return (double)std::uniform_int_distribution<long long>(
+            (long long)std::ceil(lo), (long long)std::floor(hi))(rng);
+    }
+    return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+/* Returns the number of outgoing synapses of one neuron */
+static size_t random_fan_out(std::mt19937_64 &rng,
+                             const std::string &distribution, double mean) {
+    double u;
+
+    if (distribution == "fixed") {
+        return (size_t)std::round(mean);
+    }
+    if (distribution == "uniform") {
+        return std::uniform_int_distribution<size_t>(
+            0, (size_t)std::round(2 * mean))(rng);
+    }
+
+    // Pareto with shape 2.5, whose mean is 3 times its minimum
+    u = std::uniform_real_distribution<double>(0, 1)(rng);
+    return (size_t)std::floor(mean / 3 * std::pow(1 - u, -1 / 1.5));
+}
+
+/* Returns a delay in [1, max_delay] */
+static int random_delay(std::mt19937_64 &rng, const std::string &distribution,
+                        double mean, int max_delay) {
+    int delay;
+
+    if (distribution == "uniform") {
+        return std::uniform_int_distribution<int>(1, max_delay)(rng);
+    }
+    if (distribution == "fixed") {
+        delay = (int)std::round(mean);
+    } else {
+        delay = 1 + std::geometric_distribution<int>(1 / mean)(rng);
+    }
+    return std::max(1, std::min(delay, max_delay));
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser parse;
+    nlohmann::json params;
+    std::mt19937_64 rng;
+    std::unordered_set<size_t> targets;
+    std::string fan_out_dist;
+    std::string delay_dist;
+    std::string type;
+    FILE *stim;
+    size_t n;
+    size_t num_inputs;
+    size_t num_outputs;
+    size_t fan_out;
+    size_t num_edges;
+    size_t i;
+    size_t j;
+    size_t k;
+    size_t to;
+    double fan_out_mean;
+    double delay_mean;
+    double recurrence;
+    double spike_rate;
+    double min_weight;
+    double max_weight;
+    double min_threshold;
+    double max_threshold;
+    int max_delay;
+    int timesteps;
+    int t;
+    bool discrete;
+    bool configurable_leak;
+    bool first;
+    bool spiked;
+
+    try {
+        try {
+            parse.add<size_t>("neurons", 'n', "number of neurons", false,
+                              1000);
+            parse.add<size_t>("inputs", 'i', "number of input neurons",
+                              false, 16);
+            parse.add<size_t>("outputs", 'o', "number of output neurons",
+                              false, 16);
+            parse.add<double>("fan-out", 'f',
+                              "mean number of outgoing synapses per neuron",
+                              false, 8);
+            parse.add<string>("fan-out-dist", '\0',
+                              "distribution of the fan-out, "
+                              "<fixed|uniform|power>",
+                              false, "uniform",
+                              cmdline::oneof<string>("fixed", "uniform",
+                                                     "power"));
+            parse.add<string>("delay-dist", '\0',
+                              "distribution of the synapse delays, "
+                              "<uniform|fixed|geometric>",
+                              false, "uniform",
+                              cmdline::oneof<string>("uniform", "fixed",
+                                                     "geometric"));
+            parse.add<double>("delay-mean", '\0',
+                              "delay for --delay-dist fixed and mean delay "
+                              "for --delay-dist geometric",
+                              false, 2);
+            parse.add<double>("recurrence", 'r',
+                              "fraction of synapses that may close a cycle, "
+                              "0 for a feed-forward network",
+                              false, 0.1, cmdline::range(0.0, 1.0));
+            parse.add<string>("params", '\0',
+                              "RISP proc_params file, such as "
+                              "params/risp_127.txt",
+                              false, "params/risp_127.txt");
+            parse.add<unsigned long>("seed", 's', "random seed", false, 0);
+            parse.add<string>("stimulus", '\0',
+                              "file to write a random processor_tool "
+                              "stimulus to",
+                              false, "");
+            parse.add<int>("timesteps", 't',
+                           "number of timesteps of the stimulus", false, 100);
+            parse.add<double>("spike-rate", '\0',
+                              "probability that an input neuron receives a "
+                              "spike in a timestep of the stimulus",
+                              false, 0.1, cmdline::range(0.0, 1.0));
+            parse.parse_check(argc, argv);
+        } catch (std::runtime_error &e) {
+            std::cerr << "Error parsing command line arguments" << std::endl;
+            throw e;
+        }
+
+        n = parse.get<size_t>("neurons");
+        num_inputs = parse.get<size_t>("inputs");
+        num_outputs = parse.get<size_t>("outputs");
+        if (num_inputs == 0 || num_outputs == 0 ||
+            num_inputs + num_outputs > n) {
+            throw(std::string) "--inputs and --outputs must be at least 1 "
+                               "and fit in --neurons together";
+        }
+        fan_out_dist = parse.get<string>("fan-out-dist");
+        fan_out_mean = parse.get<double>("fan-out");
+        delay_dist = parse.get<string>("delay-dist");
+        delay_mean = parse.get<double>("delay-mean");
+        if (fan_out_mean < 0 || delay_mean < 1) {
+            throw(std::string) "--fan-out must not be negative and "
+                               "--delay-mean must be at least 1";
+        }
+        recurrence = parse.get<double>("recurrence");
+        rng.seed(parse.get<unsigned long>("seed"));
+
+        params = json_from_string_or_file(parse.get<string>("params"));
+        discrete = params.value("discrete", true);
+        min_weight = params["min_weight"].get<double>();
+        max_weight = params["max_weight"].get<double>();
+        min_threshold = params["min_threshold"].get<double>();
+        max_threshold = params["max_threshold"].get<double>();
+        max_delay = params["max_delay"].get<int>();
+        configurable_leak = params.value("leak_mode", "none") ==
+                            std::string("configurable");
+        type = discrete ? "73" : "68";
+
+        // Properties; 73 and 68 are 'I' and 'D'
+        std::cout << "{\"Properties\":{\"node_properties\":["
+                  << "{\"name\":\"Threshold\",\"type\":" << type
+                  << ",\"index\":0,\"size\":1,\"min_value\":" << min_threshold
+                  << ",\"max_value\":" << max_threshold << "}";
+        if (configurable_leak) {
+            std::cout << ",{\"name\":\"Leak\",\"type\":73,\"index\":1,"
+                      << "\"size\":1,\"min_value\":0,\"max_value\":1}";
+        }
+        std::cout << "],\"edge_properties\":["
+                  << "{\"name\":\"Delay\",\"type\":73,\"index\":1,\"size\":1,"
+                  << "\"min_value\":1,\"max_value\":" << max_delay << "},"
+                  << "{\"name\":\"Weight\",\"type\":" << type
+                  << ",\"index\":0,\"size\":1,\"min_value\":" << min_weight
+                  << ",\"max_value\":" << max_weight << "}],"
+                  << "\"network_properties\":[]},\n";
+        std::cout.precision(17);
+
+        // Nodes
+        std::cout << "\"Nodes\":[";
+        for (i = 0; i < n; i++) {
+            std::cout << (i ? ",\n" : "\n") << "{\"id\":" << i
+                      << ",\"values\":["
+                      << random_value(rng, min_threshold, max_threshold,
+                                      discrete);
+            if (configurable_leak) {
+                std::cout << ","
+                          << std::uniform_int_distribution<int>(0, 1)(rng);
+            }
+            std::cout << "]}";
+        }
+
+        // Edges, without duplicates since the framework rejects them
+        std::cout << "],\n\"Edges\":[";
+        first = true;
+        num_edges = 0;
+        for (i = 0; i < n; i++) {
+            fan_out = std::min(random_fan_out(rng, fan_out_dist, fan_out_mean),
+                               n);
+            targets.clear();
+            for (k = 0; k < 4 * fan_out && targets.size() < fan_out; k++) {
+                if (i + 1 < n && (recurrence == 0 ||
+                                  std::uniform_real_distribution<double>(
+                                      0, 1)(rng) >= recurrence)) {
+                    to = std::uniform_int_distribution<size_t>(i + 1,
+                                                               n - 1)(rng);
+                } else if (recurrence > 0) {
+                    to = std::uniform_int_distribution<size_t>(0, i)(rng);
+                } else {
+                    break;
+                }
+                if (!targets.insert(to).second) {
+                    continue;
+                }
+                std::cout << (first ? "\n" : ",\n") << "{\"from\":" << i
+                          << ",\"to\":" << to << ",\"values\":["
+                          << random_value(rng, min_weight, max_weight,
+                                          discrete)
+                          << ","
+                          << random_delay(rng, delay_dist, delay_mean,
+                                          max_delay)
+                          << "]}";
+                first = false;
+                num_edges++;
+            }
+        }
+
+        // Inputs, outputs and associated data
+        std::cout << "],\n\"Inputs\":[";
+        for (i = 0; i < num_inputs; i++) {
+            std::cout << (i ? "," : "") << i;
+        }
+        std::cout << "],\n\"Outputs\":[";
+        for (i = 0; i < num_outputs; i++) {
+            std::cout << (i ? "," : "") << n - num_outputs + i;
+        }
+        std::cout << "],\n\"Network_Values\":[],\n"
+                  << "\"Associated_Data\":{\"other\":{\"proc_name\":\"risp\"},"
+                  << "\"proc_params\":" << params.dump() << "}}" << std::endl;
+
+        std::cerr << "Generated " << n << " neurons and " << num_edges
+                  << " synapses" << std::endl;
+
+        // Stimulus: each timestep's spikes at relative time 0, then RUN 1,
+        // so no spike is scheduled beyond the generated MAX_NUM_TIMESTEPS
+        if (parse.get<string>("stimulus") != "") {
+            stim = fopen(parse.get<string>("stimulus").c_str(), "w");
+            if (stim == NULL) {
+                throw(std::string) "Cannot open " +
+                    parse.get<string>("stimulus") + " for writing";
+            }
+            timesteps = parse.get<int>("timesteps");
+            spike_rate = parse.get<double>("spike-rate");
+            for (t = 0; t < timesteps; t++) {
+                spiked = false;
+                for (j = 0; j < num_inputs; j++) {
+                    if (std::uniform_real_distribution<double>(0, 1)(rng) <
+                        spike_rate) {
+                        fprintf(stim, "%s %zu 0 1", spiked ? "" : "AS", j);
+                        spiked = true;
+                    }
+                }
+                fprintf(stim, "%sRUN 1\n", spiked ? "\n" : "");
+            }
+            fclose(stim);
+        }
+
+    } catch (const json::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const std::string &e) {
+        std::cerr << e << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,597 @@
+/* Runs the testing/ corpus against every backend in parallel. It checks the
+ * same things as scripts/test.bash, but each test builds its network once
+ * and generates code for every configuration in scripts/processors.txt (a
+ * backend and a set of framework_embedder options), the processor_tool harness
+ * is compiled into this program instead of into every test, and the
+ * generated code is loaded with dlopen(). The code keeps the defines the
+ * embedder emitted instead of raising NUM_SYNAPSES and MAX_NUM_TIMESTEPS to
+ * 1600, so the tests also check the sizes of the generated arrays. All
+ * failures are reported, and the time spent in run() by each test and
+ * configuration is written to test_output.txt. Files of failed tests are
+ * left in testing_scratch/.
+ *
+ * usage: bin/test_runner [-j jobs] [--keep] [processor ...] */
+
+#include "utils/cmdline.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/* Unmangled entry points appended to the generated code, which is compiled
+ * as C++ */
+static const char *RUNNER_ENTRY_POINTS =
+    "\n"
+    "extern \"C\" unsigned int runner_num_inputs() {\n"
+    "    return NUM_INPUT_NEURONS;\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int runner_num_outputs() {\n"
+    "    return NUM_OUTPUT_NEURONS;\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int runner_max_num_timesteps() {\n"
+    "    return MAX_NUM_TIMESTEPS;\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int runner_input_node_id(unsigned int input_ind) {\n"
+    "    return INPUT_IND_TO_NODE_ID[input_ind];\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int runner_output_node_id(unsigned int output_ind) "
+    "{\n"
+    "    return OUTPUT_IND_TO_NODE_ID[output_ind];\n"
+    "}\n"
+    "\n"
+    "extern \"C\" void runner_apply_spike(unsigned int input_ind, "
+    "unsigned int time, double value) {\n"
+    "    apply_spike(input_ind, time, value);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" void runner_run(double duration) {\n"
+    "    run(duration);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" unsigned int runner_output_count(unsigned int output_ind) {\n"
+    "    return output_count(output_ind);\n"
+    "}\n"
+    "\n"
+    "extern \"C\" void runner_clear_activity() {\n"
+    "    clear_activity();\n"
+    "}\n"
+    "\n"
+    "#ifdef SPIKE_QUEUE_SIZE\n"
+    "extern \"C\" int runner_enqueue_spike(unsigned int input_ind, "
+    "unsigned int time, double value) {\n"
+    "    return enqueue_spike(input_ind, time, value);\n"
+    "}\n"
+    "#endif\n";
+
+/* Generated code loaded from a shared object */
+struct Simulator {
+    void *handle;
+    unsigned int (*num_inputs)();
+    unsigned int (*num_outputs)();
+    unsigned int (*max_num_timesteps)();
+    unsigned int (*input_node_id)(unsigned int);
+    unsigned int (*output_node_id)(unsigned int);
+    void (*apply_spike)(unsigned int, unsigned int, double);
+    void (*run)(double);
+    unsigned int (*output_count)(unsigned int);
+    void (*clear_activity)();
+    int (*enqueue_spike)(unsigned int, unsigned int, double); /* Or NULL */
+};
+
+/* Input spike too far ahead for the generated code to accept yet */
+struct Pending_Spike {
+    unsigned long time;
+    unsigned int input_ind;
+    double value;
+};
+
+struct Result {
+    bool passed;
+    std::string error;
+    double run_seconds;
+};
+
+/* A line of scripts/processors.txt */
+struct Config {
+    std::string processor;
+    std::string options;
+};
+
+struct Test {
+    std::string dir;
+    std::string label;
+    std::vector<Result> results; /* One per configuration */
+};
+
+static std::string fr;
+static std::string root;
+static std::string compiler;
+static std::vector<Config> configs;
+static bool keep;
+
+static std::string read_file(const std::string &path) {
+    std::ifstream fin(path);
+    std::stringstream ss;
+
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+static void load_simulator(const std::string &path, Simulator &sim) {
+    sim.handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (sim.handle == NULL) {
+        throw std::string("Cannot load the generated code: ") + dlerror();
+    }
+    *(void **)&sim.num_inputs = dlsym(sim.handle, "runner_num_inputs");
+    *(void **)&sim.num_outputs = dlsym(sim.handle, "runner_num_outputs");
+    *(void **)&sim.max_num_timesteps =
+        dlsym(sim.handle, "runner_max_num_timesteps");
+    *(void **)&sim.input_node_id = dlsym(sim.handle, "runner_input_node_id");
+    *(void **)&sim.output_node_id =
+        dlsym(sim.handle, "runner_output_node_id");
+    *(void **)&sim.apply_spike = dlsym(sim.handle, "runner_apply_spike");
+    *(void **)&sim.run = dlsym(sim.handle, "runner_run");
+    *(void **)&sim.output_count = dlsym(sim.handle, "runner_output_count");
+    *(void **)&sim.clear_activity =
+        dlsym(sim.handle, "runner_clear_activity");
+    if (sim.num_inputs == NULL || sim.num_outputs == NULL ||
+        sim.max_num_timesteps == NULL || sim.input_node_id == NULL ||
+        sim.output_node_id == NULL || sim.apply_spike == NULL ||
+        sim.run == NULL || sim.output_count == NULL ||
+        sim.clear_activity == NULL) {
+        dlclose(sim.handle);
+        throw(std::string) "The generated code is missing its entry points";
+    }
+    *(void **)&sim.enqueue_spike = dlsym(sim.handle, "runner_enqueue_spike");
+}
+
+static unsigned int input_ind_of(Simulator &sim, unsigned int node_id) {
+    unsigned int i;
+
+    for (i = 0; i < sim.num_inputs(); i++) {
+        if (sim.input_node_id(i) == node_id) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* apply_spike() drops spikes MAX_NUM_TIMESTEPS or more timesteps ahead, so
+ * those wait in pending until they are close enough. Code with a spike queue
+ * gets its spikes through enqueue_spike() while there is room, which run()
+ * applies at the start of the next timestep just like apply_spike(). */
+static void apply_spike(Simulator &sim, std::vector<Pending_Spike> &pending,
+                        unsigned long now, unsigned int input_ind,
+                        unsigned int time, double value) {
+    if (time < sim.max_num_timesteps()) {
+        if (sim.enqueue_spike == NULL ||
+            !sim.enqueue_spike(input_ind, time, value)) {
+            sim.apply_spike(input_ind, time, value);
+        }
+    } else {
+        pending.push_back(Pending_Spike{now + time, input_ind, value});
+    }
+}
+
+/* The processor_tool harness of scripts/test.bash, printing into a string.
+ * Unlike scripts/test.bash it keeps the emitted MAX_NUM_TIMESTEPS, holding
+ * back the spikes that do not fit in it. */
+static std::string run_commands(Simulator &sim, const std::string &commands,
+                                int step, double &run_seconds) {
+    std::vector<std::vector<int>> output_raster;
+    std::vector<Pending_Spike> pending;
+    std::stringstream lines(commands);
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::string> tokens;
+    std::string token;
+    std::string line;
+    std::string out;
+    char buf[64];
+    unsigned int input_ind;
+    unsigned int output_spikes;
+    unsigned long now;
+    size_t i;
+    size_t j;
+
+    now = 0;
+    while (std::getline(lines, line)) {
+        std::stringstream ss(line);
+
+        tokens.clear();
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() == 0) {
+            continue;
+        } else if (tokens[0] == "ML" || tokens[0] == "GT" ||
+                   tokens[0] == "NCH") {
+            continue;
+        } else if (tokens[0] == "Q") {
+            break;
+        } else if (tokens[0] == "ASR") {
+            input_ind = input_ind_of(sim, std::stoi(tokens[1]));
+            for (i = 0; i < tokens[2].size(); i++) {
+                apply_spike(sim, pending, now, input_ind, i,
+                            tokens[2][i] == '1');
+            }
+        } else if (tokens[0] == "AS") {
+            for (i = 1; i + 2 < tokens.size(); i += 3) {
+                apply_spike(sim, pending, now,
+                            input_ind_of(sim, std::stoi(tokens[i])),
+                            std::stoi(tokens[i + 1]),
+                            std::stof(tokens[i + 2]));
+            }
+        } else if (tokens[0] == "RUN") {
+            output_raster.clear();
+            output_raster.resize(sim.num_outputs());
+            for (i = 0; i < (size_t)std::stoi(tokens[1]); i++) {
+                j = 0;
+                while (j < pending.size()) {
+                    if (pending[j].time - now < sim.max_num_timesteps()) {
+                        apply_spike(sim, pending, now, pending[j].input_ind,
+                                    pending[j].time - now, pending[j].value);
+                        pending[j] = pending.back();
+                        pending.pop_back();
+                    } else {
+                        j++;
+                    }
+                }
+
+                start = std::chrono::steady_clock::now();
+                sim.run(step);
+                run_seconds += std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+                now++;
+
+                for (j = 0; j < sim.num_outputs(); j++) {
+                    output_raster[j].push_back(sim.output_count(j));
+                }
+            }
+        } else if (tokens[0] == "GSR") {
+            for (i = 0; i < output_raster.size(); i++) {
+                snprintf(buf, sizeof(buf), "%-6u : ", sim.output_node_id(i));
+                out += buf;
+                for (j = 0; j < output_raster[i].size(); j++) {
+                    out += std::to_string(output_raster[i][j]);
+                }
+                out += "\n";
+            }
+        } else if (tokens[0] == "OC") {
+            for (i = 0; i < output_raster.size(); i++) {
+                output_spikes = 0;
+                for (j = 0; j < output_raster[i].size(); j++) {
+                    output_spikes += output_raster[i][j];
+                }
+                snprintf(buf, sizeof(buf), "%-6u : %u\n",
+                         sim.output_node_id(i), output_spikes);
+                out += buf;
+            }
+        } else if (tokens[0] == "OT") {
+            for (i = 0; i < output_raster.size(); i++) {
+                snprintf(buf, sizeof(buf), "%-6u : ", sim.output_node_id(i));
+                out += buf;
+                for (j = 0; j < output_raster[i].size(); j++) {
+                    if (output_raster[i][j] == 1) {
+                        snprintf(buf, sizeof(buf), "%.1f ", (float)j);
+                        out += buf;
+                    }
+                }
+                out += "\n";
+            }
+        } else if (tokens[0] == "CLEAR-A" || tokens[0] == "CA") {
+            sim.clear_activity();
+            pending.clear();
+        } else {
+            out += "Unsupported command " + tokens[0] + "\n";
+        }
+    }
+
+    return out;
+}
+
+static void run_test(Test &test) {
+    std::string scratch;
+    std::string source;
+    std::string code;
+    std::string command;
+    std::string commands;
+    std::string correct;
+    std::string output;
+    std::string options;
+    std::ofstream fout;
+    nlohmann::json params;
+    Simulator sim;
+    size_t p;
+    size_t i;
+    int step;
+    bool passed;
+
+    scratch = root + "/testing_scratch/" +
+              test.dir.substr(test.dir.rfind('/') + 1);
+    test.results.assign(configs.size(), Result{false, "", 0});
+
+    try {
+        // Build the network the same way scripts/test.bash does
+        command = "mkdir -p '" + scratch + "' && cd '" + root +
+                  "' && bash '" + test.dir + "/processor.sh' > '" + scratch +
+                  "/tmp_proc_params.json' && cd '" + scratch +
+                  "' && (echo M risp tmp_proc_params.json; echo EMPTYNET "
+                  "tmp_empty_network.txt) | '" +
+                  fr + "/cpp-apps/bin/processor_tool_risp' > /dev/null && '" +
+                  fr + "/bin/network_tool' < '" + test.dir +
+                  "/network_tool.txt' > tmp_nt_output.txt 2>&1";
+        if (system(command.c_str()) != 0 ||
+            !read_file(scratch + "/tmp_nt_output.txt").empty()) {
+            throw "There was an error in the network_tool command:\n" +
+                read_file(scratch + "/tmp_nt_output.txt");
+        }
+
+        // For runtime inclusive we step 0, otherwise 1
+        params = nlohmann::json::parse(
+            read_file(scratch + "/tmp_proc_params.json"));
+        step = params.value("run_time_inclusive", false) ? 0 : 1;
+
+        commands = read_file(test.dir + "/processor_tool.txt");
+        correct = read_file(test.dir + "/correct_output.txt");
+    } catch (const std::string &e) {
+        for (p = 0; p < configs.size(); p++) {
+            test.results[p].error = e;
+        }
+        return;
+    } catch (const std::exception &e) {
+        for (p = 0; p < configs.size(); p++) {
+            test.results[p].error = e.what();
+        }
+        return;
+    }
+
+    for (p = 0; p < configs.size(); p++) {
+        Result &r = test.results[p];
+
+        try {
+            options = configs[p].options;
+            i = options.find("{stimulus}");
+            if (i != std::string::npos) {
+                options.replace(i, 10, "'" + test.dir + "/processor_tool.txt'");
+            }
+
+            source = scratch + "/" + configs[p].processor + "_" +
+                     std::to_string(p);
+            command = "'" + root + "/bin/framework_embedder' -p " +
+                      configs[p].processor + " " + options + " < '" + scratch +
+                      "/tmp_network.txt' > '" + source + ".c' 2> '" + source +
+                      ".err'";
+            if (system(command.c_str()) != 0) {
+                throw "framework_embedder failed:\n" +
+                    read_file(source + ".err");
+            }
+
+            code = read_file(source + ".c");
+            fout.open(source + ".cpp");
+            fout << code << RUNNER_ENTRY_POINTS;
+            fout.close();
+
+            command = compiler + " -O2 -w -shared -fPIC -o '" + source +
+                      ".so' '" + source + ".cpp' 2> '" + source + ".err'";
+            if (system(command.c_str()) != 0) {
+                throw "Compiling the generated code failed:\n" +
+                    read_file(source + ".err");
+            }
+
+            load_simulator(source + ".so", sim);
+            output = run_commands(sim, commands, step, r.run_seconds);
+            dlclose(sim.handle);
+
+            if (output != correct) {
+                fout.open(source + "_output.txt");
+                fout << output;
+                fout.close();
+                throw "Output does not match the correct output.\n"
+                      "       Output file is " +
+                    source + "_output.txt\n"
+                             "       Correct output file is " +
+                    test.dir + "/correct_output.txt";
+            }
+            r.passed = true;
+        } catch (const std::string &e) {
+            r.error = e;
+        } catch (const std::exception &e) {
+            r.error = e.what();
+        }
+    }
+
+    // Failed tests keep their files for inspection
+    passed = true;
+    for (p = 0; p < configs.size(); p++) {
+        passed = passed && test.results[p].passed;
+    }
+    if (!keep && passed) {
+        command = "rm -rf '" + scratch + "'";
+        if (system(command.c_str()) != 0) {
+            fprintf(stderr, "Cannot remove %s\n", scratch.c_str());
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser parse;
+    std::vector<Test> tests;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next(0);
+    std::mutex print_lock;
+    std::vector<std::string> processors;
+    std::stringstream lines;
+    std::string supported;
+    std::string line;
+    std::string dir;
+    std::ofstream fout;
+    Config config;
+    struct dirent *ent;
+    DIR *d;
+    char cwd[4096];
+    const char *env;
+    unsigned int jobs;
+    unsigned int failures;
+    size_t t;
+    size_t p;
+
+    parse.add<unsigned int>("jobs", 'j',
+                            "number of tests to run at once, 0 for one per "
+                            "core",
+                            false, 0);
+    parse.add<std::string>("testing", '\0', "directory holding the tests",
+                           false, "testing");
+    parse.add("keep", '\0', "keep the files of every test in testing_scratch/");
+    parse.footer("[processor ...]");
+    parse.parse_check(argc, argv);
+
+    env = getenv("fr");
+    if (env == NULL || env[0] == '\0') {
+        fprintf(stderr, "Cannot find your fr (framework) environment "
+                        "variable.\n");
+        return 1;
+    }
+    fr = env;
+    env = getenv("CXX");
+    compiler = (env != NULL && env[0] != '\0') ? env : "clang++";
+    keep = parse.exist("keep");
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        fprintf(stderr, "Cannot read the working directory\n");
+        return 1;
+    }
+    root = cwd;
+
+    // Keep the configurations of the processors asked for, or all of them
+    processors = parse.rest();
+    lines.str(read_file(root + "/scripts/processors.txt"));
+    while (std::getline(lines, line)) {
+        std::stringstream ss(line);
+
+        if (!(ss >> config.processor) || config.processor[0] == '#') {
+            continue;
+        }
+        std::getline(ss >> std::ws, config.options);
+        if ((supported + " ").find(" " + config.processor + " ") ==
+            std::string::npos) {
+            supported += " " + config.processor;
+        }
+        if (processors.empty() ||
+            std::find(processors.begin(), processors.end(),
+                      config.processor) != processors.end()) {
+            configs.push_back(config);
+        }
+    }
+    for (p = 0; p < processors.size(); p++) {
+        if ((supported + " ").find(" " + processors[p] + " ") ==
+            std::string::npos) {
+            fprintf(stderr, "Procesor %s not supported\n",
+                    processors[p].c_str());
+            fprintf(stderr, "    Supported Processors: (%s)\n",
+                    supported.substr(1).c_str());
+            return 1;
+        }
+    }
+
+    // Every subdirectory of the testing directory is a test
+    dir = parse.get<std::string>("testing");
+    if (dir[0] != '/') {
+        dir = root + "/" + dir;
+    }
+    d = opendir(dir.c_str());
+    if (d == NULL) {
+        fprintf(stderr, "Cannot open %s\n", dir.c_str());
+        return 1;
+    }
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] != '.' &&
+            std::ifstream(dir + "/" + ent->d_name + "/label.txt").good()) {
+            tests.push_back(Test{dir + "/" + ent->d_name, "", {}});
+        }
+    }
+    closedir(d);
+    std::sort(tests.begin(), tests.end(),
+              [](const Test &a, const Test &b) { return a.dir < b.dir; });
+    for (t = 0; t < tests.size(); t++) {
+        tests[t].label = read_file(tests[t].dir + "/label.txt");
+        while (!tests[t].label.empty() && tests[t].label.back() == '\n') {
+            tests[t].label.pop_back();
+        }
+    }
+
+    jobs = parse.get<unsigned int>("jobs");
+    if (jobs == 0) {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (t = 0; t < jobs; t++) {
+        workers.push_back(std::thread([&]() {
+            size_t i;
+            size_t p;
+            bool passed;
+
+            while ((i = next++) < tests.size()) {
+                run_test(tests[i]);
+
+                passed = true;
+                for (p = 0; p < configs.size(); p++) {
+                    passed = passed && tests[i].results[p].passed;
+                }
+                std::lock_guard<std::mutex> lock(print_lock);
+                printf("%s Test %s - %s\n", passed ? "Passed" : "FAILED",
+                       tests[i].dir.substr(root.size() + 1).c_str(),
+                       tests[i].label.c_str());
+                fflush(stdout);
+            }
+        }));
+    }
+    for (t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    // Report every failure and the per-test run() time
+    failures = 0;
+    fout.open(root + "/test_output.txt");
+    fout << "test\tprocessor\toptions\tresult\trun_us\n";
+    for (t = 0; t < tests.size(); t++) {
+        for (p = 0; p < configs.size(); p++) {
+            Result &r = tests[t].results[p];
+
+            fout << tests[t].dir.substr(root.size() + 1) << "\t"
+                 << configs[p].processor << "\t" << configs[p].options << "\t"
+                 << (r.passed ? "pass" : "FAIL") << "\t"
+                 << r.run_seconds * 1e6 << "\n";
+            if (!r.passed) {
+                failures++;
+                fprintf(stderr, "\nTest %s - %s (%s%s%s)\nError: %s\n",
+                        tests[t].dir.substr(root.size() + 1).c_str(),
+                        tests[t].label.c_str(), configs[p].processor.c_str(),
+                        configs[p].options.empty() ? "" : " ",
+                        configs[p].options.c_str(), r.error.c_str());
+            }
+        }
+    }
+    fout.close();
+
+    printf("%u of %zu test runs passed, times written to test_output.txt\n",
+           (unsigned int)(tests.size() * configs.size()) - failures,
+           tests.size() * configs.size());
+
+    return failures == 0 ? 0 : 1;
+}